@@ -0,0 +1,362 @@
+// Ingest throughput benchmark.
+//
+// Generates a synthetic TSV corpus, loads it through DbDataSet::LoadFromPath and prints one JSON object
+// per run with throughput, per stage timings and peak RSS.
+//
+//   ingest_bench --rows 1000000 --cols 12 --len 4:24 --dist uniform --numeric 0.3 --utf8 0.05 --crlf
+//
+// --rows N          data rows per file
+// --cols N          columns per file
+// --files N         files in the corpus
+// --len MIN:MAX     field length range in bytes
+// --dist NAME       uniform or skewed (most fields short, a long tail up to MAX)
+// --numeric F       fraction of columns holding integers
+// --lowcard F       fraction of columns drawn from a small set of values
+// --utf8 F          fraction of text characters that are multi byte UTF-8
+// --crlf            end lines with \r\n
+// --runs N          load the corpus N times
+// --dir PATH        where the corpus is written, the files written there are removed afterwards unless --keep
+// --seed N          generator seed
+// --export FORMAT   after each load export the first table as tsv, csv or arrow and time it
+// --sort N          sort the export by column N
+// --zstd            compress the export, when built with zstd
+
+#include "tsvdata.hpp"
+
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	struct CorpusOptions
+	{
+		size_t rows = 200000;
+		size_t cols = 12;
+		size_t files = 1;
+		size_t minLen = 4;
+		size_t maxLen = 24;
+		bool skewed = false;
+		double numeric = 0.25;
+		double lowCard = 0.25;
+		double utf8 = 0.0;
+		bool crlf = false;
+		uint64_t seed = 1;
+	};
+
+	struct RunOptions
+	{
+		CorpusOptions corpus;
+		size_t runs = 3;
+		std::filesystem::path dir = std::filesystem::temp_directory_path() / "gui4life_bench";
+		bool keep = false;
+		bool exporting = false;
+		data::ExportOptions exportOptions;
+		int exportSort = 0;
+	};
+
+	enum class ColumnKind { Text, Numeric, LowCard };
+
+	class CorpusWriter
+	{
+		const CorpusOptions& opt;
+		std::mt19937_64 rng;
+		std::vector<ColumnKind> kinds;
+		std::vector<std::string> lowCardValues;
+
+		size_t fieldLength()
+		{
+			if (!opt.skewed)
+				return std::uniform_int_distribution<size_t>(opt.minLen, opt.maxLen)(rng);
+
+			auto mean = double(opt.maxLen - opt.minLen) / 8.0 + 1.0;
+			auto len = opt.minLen + size_t(std::exponential_distribution<double>(1.0 / mean)(rng));
+			return std::min(len, opt.maxLen);
+		}
+
+		void text(std::string& out, size_t len)
+		{
+			static const char* multi[] = { "\xC3\xA9", "\xC3\xBC", "\xE2\x9C\x93", "\xE6\x97\xA5", "\xF0\x9F\x98\x80" };
+			std::uniform_real_distribution<double> coin(0.0, 1.0);
+			std::uniform_int_distribution<int> letter('a', 'z');
+
+			for (size_t i = 0; i < len; ++i)
+			{
+				if (opt.utf8 > 0 && coin(rng) < opt.utf8)
+					out.append(multi[rng() % std::size(multi)]);
+				else
+					out.push_back(char(letter(rng)));
+			}
+		}
+
+	public:
+		explicit CorpusWriter(const CorpusOptions& options) : opt(options), rng(options.seed)
+		{
+			std::uniform_real_distribution<double> coin(0.0, 1.0);
+			for (size_t c = 0; c < opt.cols; ++c)
+			{
+				auto pick = coin(rng);
+				kinds.push_back(pick < opt.numeric ? ColumnKind::Numeric : pick < opt.numeric + opt.lowCard ? ColumnKind::LowCard : ColumnKind::Text);
+			}
+
+			for (int i = 0; i < 12; ++i)
+			{
+				std::string value;
+				text(value, fieldLength());
+				lowCardValues.push_back(value);
+			}
+		}
+
+		uint64_t Write(const std::filesystem::path& path)
+		{
+			std::ofstream out(path, std::ios::binary);
+			const char* eol = opt.crlf ? "\r\n" : "\n";
+
+			std::string line;
+			for (size_t c = 0; c < opt.cols; ++c)
+			{
+				line.append(c ? "\t" : "").append("col_").append(std::to_string(c));
+			}
+			line.append(eol);
+			out.write(line.data(), std::streamsize(line.size()));
+
+			uint64_t bytes = line.size();
+			for (size_t r = 0; r < opt.rows; ++r)
+			{
+				line.clear();
+				for (size_t c = 0; c < opt.cols; ++c)
+				{
+					if (c)
+						line.push_back('\t');
+
+					switch (kinds[c])
+					{
+					case ColumnKind::Numeric:
+						line.append(std::to_string(rng() % 1000000000));
+						break;
+					case ColumnKind::LowCard:
+						line.append(lowCardValues[rng() % lowCardValues.size()]);
+						break;
+					case ColumnKind::Text:
+						text(line, fieldLength());
+						break;
+					}
+				}
+				line.append(eol);
+				out.write(line.data(), std::streamsize(line.size()));
+				bytes += line.size();
+			}
+			return bytes;
+		}
+	};
+
+	// Peak resident set since the last reset, in bytes
+	uint64_t peakRss()
+	{
+#if defined(__linux__)
+		std::ifstream status("/proc/self/status");
+		for (std::string line; std::getline(status, line);)
+		{
+			if (line.rfind("VmHWM:", 0) == 0)
+				return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+		}
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		return uint64_t(usage.ru_maxrss) * 1024;
+#else
+		return 0;
+#endif
+	}
+
+	void resetPeakRss()
+	{
+#if defined(__linux__)
+		std::ofstream clear("/proc/self/clear_refs");
+		clear << "5";
+#endif
+	}
+
+	bool parseArgs(int argc, char* argv[], RunOptions& opt)
+	{
+		auto& c = opt.corpus;
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			auto next = [&]() -> const char*
+				{
+					return i + 1 < argc ? argv[++i] : "";
+				};
+
+			if (arg == "--rows") c.rows = std::strtoull(next(), nullptr, 10);
+			else if (arg == "--cols") c.cols = std::max<size_t>(1, std::strtoull(next(), nullptr, 10));
+			else if (arg == "--files") c.files = std::max<size_t>(1, std::strtoull(next(), nullptr, 10));
+			else if (arg == "--len")
+			{
+				std::string range = next();
+				auto colon = range.find(':');
+				c.minLen = std::strtoull(range.c_str(), nullptr, 10);
+				c.maxLen = colon == std::string::npos ? c.minLen : std::strtoull(range.c_str() + colon + 1, nullptr, 10);
+				if (c.maxLen < c.minLen)
+					std::swap(c.minLen, c.maxLen);
+			}
+			else if (arg == "--dist") c.skewed = std::string(next()) == "skewed";
+			else if (arg == "--numeric") c.numeric = std::strtod(next(), nullptr);
+			else if (arg == "--lowcard") c.lowCard = std::strtod(next(), nullptr);
+			else if (arg == "--utf8") c.utf8 = std::strtod(next(), nullptr);
+			else if (arg == "--crlf") c.crlf = true;
+			else if (arg == "--seed") c.seed = std::strtoull(next(), nullptr, 10);
+			else if (arg == "--runs") opt.runs = std::max<size_t>(1, std::strtoull(next(), nullptr, 10));
+			else if (arg == "--dir") opt.dir = next();
+			else if (arg == "--keep") opt.keep = true;
+			else if (arg == "--export")
+			{
+				opt.exporting = true;
+				const std::string format = next();
+				opt.exportOptions.format = format == "csv" ? data::ExportFormat::Csv : format == "arrow" ? data::ExportFormat::Arrow : data::ExportFormat::Tsv;
+			}
+			else if (arg == "--sort") opt.exportSort = std::atoi(next());
+			else if (arg == "--zstd") opt.exportOptions.compress = true;
+			else
+			{
+				std::cerr << "unknown argument " << arg << "\n";
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	RunOptions opt;
+	if (!parseArgs(argc, argv, opt))
+		return 1;
+
+	const auto& c = opt.corpus;
+
+	// only what the bench writes is removed, the directory too when it made it and nothing else is left in it
+	const bool createdDir = std::filesystem::create_directories(opt.dir);
+	std::vector<std::filesystem::path> written;
+
+	CorpusWriter writer(c);
+	uint64_t corpusBytes = 0;
+	for (size_t f = 0; f < c.files; ++f)
+	{
+		written.push_back(opt.dir / ("bench_" + std::to_string(f) + ".txt"));
+		corpusBytes += writer.Write(written.back());
+	}
+
+	auto silent = [](const std::string&) {};
+
+	for (size_t run = 0; run < opt.runs; ++run)
+	{
+		resetPeakRss();
+		// every run hashes the corpus, not just the first
+		data::ForgetFingerprints();
+
+		data::DbMetaData meta;
+		std::shared_ptr<data::DbDataSet> db;
+		auto start = std::chrono::steady_clock::now();
+		try
+		{
+			db = std::make_shared<data::DbDataSet>();
+			db->LoadFromPath(opt.dir.string(), ".txt", silent);
+			meta = db->GetTableMetaData();
+		}
+		catch (...)
+		{
+			std::cerr << "load failed\n";
+			return 1;
+		}
+		auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		data::IngestStats sum;
+		size_t rows = 0;
+		for (const auto& table : meta.tables)
+		{
+			rows += table.count;
+			sum.bytes += table.ingest.bytes;
+			sum.hash_seconds += table.ingest.hash_seconds;
+			sum.read_seconds += table.ingest.read_seconds;
+			sum.split_seconds += table.ingest.split_seconds;
+			sum.insert_seconds += table.ingest.insert_seconds;
+		}
+
+		// the whole first table, no selection, to a file next to the corpus
+		std::stringstream exported;
+		if (opt.exporting && !meta.tables.empty())
+		{
+			data::SortSpec sort;
+			if (opt.exportSort > 0)
+				sort.push_back({ opt.exportSort, false });
+
+			if (run == 0)
+				written.push_back(opt.dir / "export.out");
+			auto file = std::make_shared<std::ofstream>(opt.dir / "export.out", std::ios::binary);
+			auto bytes = std::make_shared<uint64_t>(0);
+			auto exportStart = std::chrono::steady_clock::now();
+			auto job = db->Export(meta.tables[0], sort, {}, {}, nullptr, opt.exportOptions, [file, bytes](std::string_view piece)
+				{
+					*bytes += piece.size();
+					return bool(file->write(piece.data(), std::streamsize(piece.size())));
+				}, silent);
+			while (!job->Done())
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			auto exportSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - exportStart).count();
+
+			exported << ",\"export\":{\"format\":\"" << (opt.exportOptions.format == data::ExportFormat::Csv ? "csv" : opt.exportOptions.format == data::ExportFormat::Arrow ? "arrow" : "tsv") << "\""
+				<< ",\"zstd\":" << (opt.exportOptions.compress && opt.exportOptions.format != data::ExportFormat::Arrow && data::CanCompressExports() ? "true" : "false")
+				<< ",\"sort\":" << opt.exportSort
+				<< ",\"failed\":" << (job->Failed() ? "true" : "false")
+				<< ",\"rows\":" << job->Rows()
+				<< ",\"bytes\":" << *bytes
+				<< ",\"seconds\":" << exportSeconds
+				<< ",\"rows_per_s\":" << (exportSeconds > 0 ? double(job->Rows()) / exportSeconds : 0.0)
+				<< ",\"mb_per_s\":" << (exportSeconds > 0 ? double(*bytes) / (1024.0 * 1024.0) / exportSeconds : 0.0) << "}";
+		}
+		meta.tables.clear();
+		db.reset();
+
+		std::stringstream json;
+		json << "{\"run\":" << run
+			<< ",\"rows\":" << rows
+			<< ",\"cols\":" << c.cols
+			<< ",\"files\":" << c.files
+			<< ",\"bytes\":" << corpusBytes
+			<< ",\"crlf\":" << (c.crlf ? "true" : "false")
+			<< ",\"utf8\":" << c.utf8
+			<< ",\"numeric\":" << c.numeric
+			<< ",\"seconds\":" << seconds
+			<< ",\"rows_per_s\":" << (seconds > 0 ? double(rows) / seconds : 0.0)
+			<< ",\"mb_per_s\":" << (seconds > 0 ? double(corpusBytes) / (1024.0 * 1024.0) / seconds : 0.0)
+			<< ",\"stages\":{\"hash\":" << sum.hash_seconds
+			<< ",\"read\":" << sum.read_seconds
+			<< ",\"split\":" << sum.split_seconds
+			<< ",\"insert\":" << sum.insert_seconds << "}"
+			<< ",\"peak_rss\":" << peakRss()
+			<< exported.str()
+			<< "}";
+		std::cout << json.str() << std::endl;
+	}
+
+	if (!opt.keep)
+	{
+		std::error_code ec;
+		for (const auto& path : written)
+			std::filesystem::remove(path, ec);
+		if (createdDir)
+			std::filesystem::remove(opt.dir, ec);
+	}
+
+	return 0;
+}
@@ -0,0 +1,356 @@
+#include "codec.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	constexpr size_t detectSample = 64 * 1024;
+
+	// Length of the well formed UTF-8 sequence at p, 0 when it is malformed or runs past avail
+	size_t sequenceLength(const unsigned char* p, size_t avail)
+	{
+		const unsigned char c = p[0];
+		if (c < 0x80)
+			return 1;
+
+		size_t need = 0;
+		unsigned char lo = 0x80, hi = 0xBF;
+
+		if (c >= 0xC2 && c <= 0xDF) need = 1;
+		else if (c == 0xE0) { need = 2; lo = 0xA0; }
+		else if (c == 0xED) { need = 2; hi = 0x9F; }
+		else if (c >= 0xE1 && c <= 0xEF) need = 2;
+		else if (c == 0xF0) { need = 3; lo = 0x90; }
+		else if (c == 0xF4) { need = 3; hi = 0x8F; }
+		else if (c >= 0xF1 && c <= 0xF3) need = 3;
+		else return 0;
+
+		if (avail <= need)
+			return 0;
+		if (p[1] < lo || p[1] > hi)
+			return 0;
+		for (size_t i = 2; i <= need; ++i)
+		{
+			if ((p[i] & 0xC0) != 0x80)
+				return 0;
+		}
+		return need + 1;
+	}
+
+	// Number of leading ASCII bytes, checked 16 at a time
+	size_t asciiPrefix(const unsigned char* p, size_t len)
+	{
+		size_t i = 0;
+#ifdef CODEC_SSE2
+		for (; i + 64 <= len; i += 64)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 16));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 32));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 48));
+			if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))))
+				break;
+		}
+		for (; i + 16 <= len; i += 16)
+		{
+			if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i))))
+				break;
+		}
+#else
+		for (; i + 8 <= len; i += 8)
+		{
+			uint64_t v;
+			memcpy(&v, p + i, sizeof(v));
+			if (v & 0x8080808080808080ull)
+				break;
+		}
+#endif
+		while (i < len && p[i] < 0x80)
+			++i;
+		return i;
+	}
+
+	void appendCodePoint(uint32_t cp, std::string& out)
+	{
+		if (cp < 0x80)
+		{
+			out.push_back(char(cp));
+		}
+		else if (cp < 0x800)
+		{
+			out.push_back(char(0xC0 | (cp >> 6)));
+			out.push_back(char(0x80 | (cp & 0x3F)));
+		}
+		else if (cp < 0x10000)
+		{
+			out.push_back(char(0xE0 | (cp >> 12)));
+			out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+			out.push_back(char(0x80 | (cp & 0x3F)));
+		}
+		else
+		{
+			out.push_back(char(0xF0 | (cp >> 18)));
+			out.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+			out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+			out.push_back(char(0x80 | (cp & 0x3F)));
+		}
+	}
+
+	constexpr uint32_t replacement = 0xFFFD;
+
+	size_t repairUtf8(const unsigned char* p, size_t len, std::string& out)
+	{
+		size_t i = 0;
+		while (i < len)
+		{
+			auto ascii = asciiPrefix(p + i, len - i);
+			out.append(reinterpret_cast<const char*>(p + i), ascii);
+			i += ascii;
+			if (i == len)
+				break;
+
+			auto seq = sequenceLength(p + i, len - i);
+			if (seq)
+			{
+				out.append(reinterpret_cast<const char*>(p + i), seq);
+				i += seq;
+			}
+			else
+			{
+				appendCodePoint(replacement, out);
+				i++;
+			}
+		}
+		return i;
+	}
+
+	size_t latin1ToUtf8(const unsigned char* p, size_t len, std::string& out)
+	{
+		out.reserve(out.size() + len + len / 8);
+
+		size_t i = 0;
+		while (i < len)
+		{
+			auto ascii = asciiPrefix(p + i, len - i);
+			out.append(reinterpret_cast<const char*>(p + i), ascii);
+			i += ascii;
+
+			for (; i < len && p[i] >= 0x80; ++i)
+			{
+				out.push_back(char(0xC0 | (p[i] >> 6)));
+				out.push_back(char(0x80 | (p[i] & 0x3F)));
+			}
+		}
+		return i;
+	}
+
+	size_t utf16ToUtf8(const unsigned char* p, size_t len, bool bigEndian, bool final, std::string& out)
+	{
+		auto unit = [&](size_t at) -> uint32_t
+			{
+				return bigEndian ? (uint32_t(p[at]) << 8) | p[at + 1] : (uint32_t(p[at + 1]) << 8) | p[at];
+			};
+
+		out.reserve(out.size() + len / 2);
+
+		size_t i = 0;
+		while (i + 2 <= len)
+		{
+#ifdef CODEC_SSE2
+			// 8 code units at a time while they are all ASCII
+			const __m128i high = _mm_set1_epi16(short(0xFF80));
+			char packed[16];
+			while (i + 16 <= len)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+				if (bigEndian)
+					v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, high), _mm_setzero_si128())) != 0xFFFF)
+					break;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(packed), _mm_packus_epi16(v, v));
+				out.append(packed, 8);
+				i += 16;
+			}
+			if (i + 2 > len)
+				break;
+#endif
+			uint32_t cu = unit(i);
+			if (cu >= 0xD800 && cu <= 0xDBFF)
+			{
+				if (i + 4 > len)
+				{
+					if (!final)
+						return i;
+					appendCodePoint(replacement, out);
+					i += 2;
+					continue;
+				}
+
+				uint32_t low = unit(i + 2);
+				if (low >= 0xDC00 && low <= 0xDFFF)
+				{
+					appendCodePoint(0x10000 + ((cu - 0xD800) << 10) + (low - 0xDC00), out);
+					i += 4;
+				}
+				else
+				{
+					appendCodePoint(replacement, out);
+					i += 2;
+				}
+			}
+			else if (cu >= 0xDC00 && cu <= 0xDFFF)
+			{
+				appendCodePoint(replacement, out);
+				i += 2;
+			}
+			else
+			{
+				appendCodePoint(cu, out);
+				i += 2;
+			}
+		}
+
+		if (final && i < len)
+		{
+			appendCodePoint(replacement, out);
+			i = len;
+		}
+		return i;
+	}
+}
+
+namespace codec
+{
+	const char* EncodingName(Encoding encoding)
+	{
+		switch (encoding)
+		{
+		case Encoding::Utf8: return "UTF-8";
+		case Encoding::Utf8Bom: return "UTF-8 (BOM)";
+		case Encoding::Utf16LE: return "UTF-16LE";
+		case Encoding::Utf16BE: return "UTF-16BE";
+		case Encoding::Latin1: return "Latin-1";
+		}
+		return "unknown";
+	}
+
+	Encoding Detect(const char* data, size_t len, size_t& bomSize)
+	{
+		auto p = reinterpret_cast<const unsigned char*>(data);
+
+		bomSize = 0;
+		if (len >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF)
+		{
+			bomSize = 3;
+			return Encoding::Utf8Bom;
+		}
+		if (len >= 2 && p[0] == 0xFF && p[1] == 0xFE)
+		{
+			bomSize = 2;
+			return Encoding::Utf16LE;
+		}
+		if (len >= 2 && p[0] == 0xFE && p[1] == 0xFF)
+		{
+			bomSize = 2;
+			return Encoding::Utf16BE;
+		}
+
+		auto sample = len < detectSample ? len : detectSample;
+
+		// text in UTF-16 has a zero in every other byte for the ASCII range, tabs and newlines included
+		size_t evenZero = 0, oddZero = 0;
+		for (size_t i = 0; i + 1 < sample; i += 2)
+		{
+			evenZero += p[i] == 0;
+			oddZero += p[i + 1] == 0;
+		}
+		const auto pairs = sample / 2;
+		if (pairs && oddZero * 4 > pairs && evenZero * 16 < pairs)
+			return Encoding::Utf16LE;
+		if (pairs && evenZero * 4 > pairs && oddZero * 16 < pairs)
+			return Encoding::Utf16BE;
+
+		// mostly well formed multi byte sequences means UTF-8 with a few damaged bytes rather than Latin-1
+		size_t multi = 0, invalid = 0;
+		for (size_t i = 0; i < sample;)
+		{
+			i += asciiPrefix(p + i, sample - i);
+			if (i == sample)
+				break;
+
+			auto seq = sequenceLength(p + i, sample - i);
+			if (seq)
+			{
+				multi++;
+				i += seq;
+			}
+			else
+			{
+				// a sequence cut off by the end of the sample isn't evidence either way
+				if (sample < len && sample - i < 4)
+					break;
+				invalid++;
+				i++;
+			}
+		}
+
+		if (invalid == 0 || multi > invalid * 4)
+			return Encoding::Utf8;
+
+		return Encoding::Latin1;
+	}
+
+	size_t ValidateUtf8(const char* data, size_t len)
+	{
+		auto p = reinterpret_cast<const unsigned char*>(data);
+
+		size_t i = 0;
+		while (i < len)
+		{
+			i += asciiPrefix(p + i, len - i);
+			if (i == len)
+				break;
+
+			auto seq = sequenceLength(p + i, len - i);
+			if (!seq)
+				return i;
+			i += seq;
+		}
+		return len;
+	}
+
+	size_t ToUtf8(Encoding encoding, const char* data, size_t len, std::string& out, bool final)
+	{
+		auto p = reinterpret_cast<const unsigned char*>(data);
+
+		switch (encoding)
+		{
+		case Encoding::Utf16LE:
+			return utf16ToUtf8(p, len, false, final, out);
+		case Encoding::Utf16BE:
+			return utf16ToUtf8(p, len, true, final, out);
+		case Encoding::Latin1:
+			return latin1ToUtf8(p, len, out);
+		case Encoding::Utf8:
+		case Encoding::Utf8Bom:
+			break;
+		}
+
+		if (!final)
+		{
+			// keep back a lead byte whose sequence continues in the next buffer
+			size_t keep = 0;
+			while (keep < 3 && keep < len && (p[len - 1 - keep] & 0xC0) == 0x80)
+				keep++;
+			if (keep < len && p[len - 1 - keep] >= 0xC0 && sequenceLength(p + len - 1 - keep, keep + 1) == 0)
+				len -= keep + 1;
+		}
+		return repairUtf8(p, len, out);
+	}
+}
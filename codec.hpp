@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace codec
+{
+	enum class Encoding
+	{
+		Utf8,
+		Utf8Bom,
+		Utf16LE,
+		Utf16BE,
+		Latin1,
+	};
+
+	const char* EncodingName(Encoding encoding);
+
+	// Looks for a byte order mark, otherwise guesses from the sample. bomSize is the number of bytes to skip.
+	Encoding Detect(const char* data, size_t len, size_t& bomSize);
+
+	// Returns the offset of the first byte that is not valid UTF-8, len when all of it is valid.
+	// A sequence cut off by the end of the buffer counts as invalid at its first byte.
+	size_t ValidateUtf8(const char* data, size_t len);
+
+	// Appends data as UTF-8, invalid input becomes U+FFFD.
+	// Returns how much was consumed, unless final a character split by the end of the buffer is left for the next call.
+	size_t ToUtf8(Encoding encoding, const char* data, size_t len, std::string& out, bool final = false);
+}
@@ -0,0 +1,798 @@
+#include "export.hpp"
+#include "sketch.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EXPORT_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef GUI4LIFE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace
+{
+	// the characters a format has to treat specially, TSV escapes them and CSV quotes fields holding them
+	constexpr char tsvSpecial[4] = { '\t', '\n', '\r', '\\' };
+	constexpr char csvSpecial[4] = { ',', '"', '\n', '\r' };
+
+	// The first of the four characters in [at, end), end when there is none
+	const char* findSpecial(const char* at, const char* end, const char (&special)[4])
+	{
+#ifdef EXPORT_SSE2
+		const __m128i a = _mm_set1_epi8(special[0]);
+		const __m128i b = _mm_set1_epi8(special[1]);
+		const __m128i c = _mm_set1_epi8(special[2]);
+		const __m128i d = _mm_set1_epi8(special[3]);
+		while (end - at >= 16)
+		{
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+			const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, a), _mm_cmpeq_epi8(chunk, b)), _mm_or_si128(_mm_cmpeq_epi8(chunk, c), _mm_cmpeq_epi8(chunk, d)));
+			const int mask = _mm_movemask_epi8(hits);
+			if (mask)
+				return at + std::countr_zero(unsigned(mask));
+			at += 16;
+		}
+#endif
+		for (; at < end; ++at)
+		{
+			const char ch = *at;
+			if (ch == special[0] || ch == special[1] || ch == special[2] || ch == special[3])
+				return at;
+		}
+		return end;
+	}
+
+	// Arrow's metadata version 5 and the members of its flatbuffers unions written here
+	constexpr uint64_t arrowVersion = 4;
+	constexpr uint64_t headerSchema = 1;
+	constexpr uint64_t headerDictionaryBatch = 2;
+	constexpr uint64_t headerRecordBatch = 3;
+	constexpr uint64_t typeInt = 2;
+	constexpr uint64_t typeFloatingPoint = 3;
+	constexpr uint64_t typeUtf8 = 5;
+	constexpr uint64_t precisionDouble = 2;
+
+	size_t pad8(size_t size)
+	{
+		return (size + 7) / 8 * 8;
+	}
+
+	// Lays a flatbuffer out front to back. What a table refers to is written after it and the table's slot for it
+	// patched, so every offset points forward the way the format wants. Little endian like the data it describes.
+	class FlatBuilder
+	{
+	public:
+		struct Field
+		{
+			int id = 0;
+			size_t size = 0;
+			uint64_t value = 0;
+			// an offset to something written later, value unused
+			bool reference = false;
+		};
+
+	private:
+		std::string m_out;
+
+		void pad(size_t alignment)
+		{
+			m_out.resize((m_out.size() + alignment - 1) / alignment * alignment, '\0');
+		}
+		template <typename T>
+		void put(T value)
+		{
+			m_out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+		void patch(size_t slot, size_t target)
+		{
+			const auto offset = uint32_t(target - slot);
+			std::memcpy(m_out.data() + slot, &offset, sizeof(offset));
+		}
+
+	public:
+		// the slot of the root table
+		FlatBuilder() { put<uint32_t>(0); }
+		size_t Root() const { return 0; }
+
+		// Writes a table for slot, the vtable right before it. Returns the slots of its references in the order given.
+		std::vector<size_t> Table(size_t slot, const std::vector<Field>& fields)
+		{
+			// largest fields first, each lands aligned since the table starts 8 aligned
+			std::vector<size_t> order(fields.size());
+			std::iota(order.begin(), order.end(), size_t(0));
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return fields[a].size > fields[b].size; });
+
+			int ids = 0;
+			for (const auto& field : fields)
+				ids = std::max(ids, field.id + 1);
+			std::vector<uint16_t> offsets(size_t(ids), 0);
+			std::vector<size_t> at(fields.size());
+			size_t bytes = 4;
+			for (auto i : order)
+			{
+				bytes = (bytes + fields[i].size - 1) / fields[i].size * fields[i].size;
+				at[i] = bytes;
+				offsets[size_t(fields[i].id)] = uint16_t(bytes);
+				bytes += fields[i].size;
+			}
+
+			pad(2);
+			const size_t vtable = m_out.size();
+			put<uint16_t>(uint16_t(4 + 2 * offsets.size()));
+			put<uint16_t>(uint16_t(bytes));
+			for (auto offset : offsets)
+				put<uint16_t>(offset);
+
+			pad(8);
+			const size_t table = m_out.size();
+			patch(slot, table);
+			put<int32_t>(int32_t(table - vtable));
+			m_out.resize(table + bytes, '\0');
+
+			std::vector<size_t> ret;
+			for (size_t i = 0; i < fields.size(); ++i)
+			{
+				if (fields[i].reference)
+					ret.push_back(table + at[i]);
+				else
+					std::memcpy(m_out.data() + table + at[i], &fields[i].value, fields[i].size);
+			}
+			return ret;
+		}
+
+		void String(size_t slot, std::string_view text)
+		{
+			pad(4);
+			patch(slot, m_out.size());
+			put<uint32_t>(uint32_t(text.size()));
+			m_out.append(text);
+			m_out.push_back('\0');
+		}
+
+		// a vector of structs, 8 aligned after its length
+		void Structs(size_t slot, const void* data, size_t count, size_t size)
+		{
+			pad(4);
+			if (m_out.size() % 8 == 0)
+				put<uint32_t>(0);
+			patch(slot, m_out.size());
+			put<uint32_t>(uint32_t(count));
+			m_out.append(static_cast<const char*>(data), count * size);
+		}
+
+		// a vector of references, returns their slots
+		std::vector<size_t> Vector(size_t slot, size_t count)
+		{
+			pad(4);
+			patch(slot, m_out.size());
+			put<uint32_t>(uint32_t(count));
+			std::vector<size_t> ret;
+			for (size_t i = 0; i < count; ++i)
+			{
+				ret.push_back(m_out.size());
+				put<uint32_t>(0);
+			}
+			return ret;
+		}
+
+		std::string Finish()
+		{
+			pad(8);
+			return std::move(m_out);
+		}
+	};
+
+	// a FieldNode or Buffer of a record batch
+	struct FlatPair
+	{
+		int64_t first = 0;
+		int64_t second = 0;
+	};
+
+	// The nodes and buffers of a record batch as they go into its metadata, and the body they describe
+	struct BatchLayout
+	{
+		std::vector<FlatPair> nodes;
+		std::vector<FlatPair> buffers;
+		std::vector<std::string_view> body;
+		uint64_t bodyLength = 0;
+
+		void Node(size_t length, size_t nulls)
+		{
+			nodes.push_back({ int64_t(length), int64_t(nulls) });
+		}
+		void Buffer(std::string_view buffer)
+		{
+			buffers.push_back({ int64_t(bodyLength), int64_t(buffer.size()) });
+			body.push_back(buffer);
+			bodyLength += pad8(buffer.size());
+		}
+	};
+
+	void writeSchema(FlatBuilder& builder, size_t slot, const std::vector<data::ArrowColumn>& columns)
+	{
+		// little endian, the fields
+		auto refs = builder.Table(slot, { { 0, 2, 0 }, { 1, 4, 0, true } });
+		auto fields = builder.Vector(refs[0], columns.size());
+		for (size_t i = 0; i < columns.size(); ++i)
+		{
+			const auto& column = columns[i];
+			const bool dictionary = column.type == data::ArrowType::Dictionary;
+			const auto type = column.type == data::ArrowType::Int64 ? typeInt : column.type == data::ArrowType::Float64 ? typeFloatingPoint : typeUtf8;
+
+			// name, nullable, type, children and the dictionary encoding
+			std::vector<FlatBuilder::Field> field = { { 0, 4, 0, true }, { 1, 1, 1 }, { 2, 1, type }, { 3, 4, 0, true }, { 5, 4, 0, true } };
+			if (dictionary)
+				field.push_back({ 4, 4, 0, true });
+			auto fieldRefs = builder.Table(fields[i], field);
+
+			builder.String(fieldRefs[0], column.name);
+			if (type == typeInt)
+				builder.Table(fieldRefs[1], { { 0, 4, 64 }, { 1, 1, 1 } });
+			else if (type == typeFloatingPoint)
+				builder.Table(fieldRefs[1], { { 0, 2, precisionDouble } });
+			else
+				builder.Table(fieldRefs[1], {});
+			// readers want the children even when there are none
+			builder.Vector(fieldRefs[2], 0);
+			if (dictionary)
+			{
+				// the column's id and signed int32 codes
+				auto encoding = builder.Table(fieldRefs[3], { { 0, 8, i }, { 1, 4, 0, true }, { 2, 1, 0 } });
+				builder.Table(encoding[0], { { 0, 4, 32 }, { 1, 1, 1 } });
+			}
+		}
+	}
+
+	void writeRecordBatch(FlatBuilder& builder, size_t slot, size_t length, const BatchLayout& layout)
+	{
+		auto refs = builder.Table(slot, { { 0, 8, length }, { 1, 4, 0, true }, { 2, 4, 0, true } });
+		builder.Structs(refs[0], layout.nodes.data(), layout.nodes.size(), sizeof(FlatPair));
+		builder.Structs(refs[1], layout.buffers.data(), layout.buffers.size(), sizeof(FlatPair));
+	}
+
+	// a Message around the header fill writes into its slot
+	template <typename Fn>
+	std::string arrowMessage(uint64_t headerType, uint64_t bodyLength, Fn&& fill)
+	{
+		FlatBuilder builder;
+		auto refs = builder.Table(builder.Root(), { { 0, 2, arrowVersion }, { 1, 1, headerType }, { 2, 4, 0, true }, { 3, 8, bodyLength } });
+		fill(builder, refs[0]);
+		return builder.Finish();
+	}
+}
+
+namespace data
+{
+	bool CanCompressExports()
+	{
+#ifdef GUI4LIFE_ZSTD
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	ExportPipe::ExportPipe(const fnWrite& out, bool compress, std::atomic<bool>& failed, const std::atomic<bool>& cancelled, std::function<void()> onFailed)
+		: m_out(out), m_failed(failed), m_cancelled(cancelled), m_onFailed(std::move(onFailed))
+	{
+#ifdef GUI4LIFE_ZSTD
+		if (compress)
+		{
+			m_zstd = ZSTD_createCCtx();
+			m_compressed.reset(new char[bufferBytes]);
+		}
+#else
+		(void)compress;
+#endif
+		m_thread = std::thread(&ExportPipe::run, this);
+	}
+
+	ExportPipe::~ExportPipe()
+	{
+		Finish();
+#ifdef GUI4LIFE_ZSTD
+		ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(m_zstd));
+#endif
+	}
+
+	ExportPipe::Buffer ExportPipe::Take()
+	{
+		std::unique_lock lock(m_lock);
+		if (m_spare.empty() && m_allocated < buffers)
+		{
+			m_allocated++;
+			return { std::unique_ptr<char[]>(new char[bufferBytes]), 0 };
+		}
+
+		m_wake.wait(lock, [&]() { return !m_spare.empty(); });
+		auto ret = std::move(m_spare.back());
+		m_spare.pop_back();
+		return ret;
+	}
+
+	void ExportPipe::Put(Buffer buffer)
+	{
+		{
+			std::lock_guard lock(m_lock);
+			m_full.push_back(std::move(buffer));
+		}
+		m_wake.notify_all();
+	}
+
+	void ExportPipe::Finish()
+	{
+		{
+			std::lock_guard lock(m_lock);
+			m_finished = true;
+		}
+		m_wake.notify_all();
+		if (m_thread.joinable())
+			m_thread.join();
+	}
+
+	bool ExportPipe::write(std::string_view piece, [[maybe_unused]] bool last)
+	{
+#ifdef GUI4LIFE_ZSTD
+		if (m_zstd)
+		{
+			// everything goes in with continue and the frame is closed by an empty last piece
+			ZSTD_inBuffer in{ piece.data(), piece.size(), 0 };
+			for (;;)
+			{
+				ZSTD_outBuffer out{ m_compressed.get(), bufferBytes, 0 };
+				const auto left = ZSTD_compressStream2(static_cast<ZSTD_CCtx*>(m_zstd), &out, &in, last ? ZSTD_e_end : ZSTD_e_continue);
+				if (ZSTD_isError(left))
+					return false;
+				if (out.pos && !m_out(std::string_view(m_compressed.get(), out.pos)))
+					return false;
+				if (last ? left == 0 : in.pos == in.size)
+					return true;
+			}
+		}
+#endif
+		return piece.empty() || m_out(piece);
+	}
+
+	void ExportPipe::run()
+	{
+		auto fail = [&]()
+			{
+				m_failed = true;
+				if (m_onFailed)
+					m_onFailed();
+			};
+
+		for (;;)
+		{
+			Buffer buffer;
+			{
+				std::unique_lock lock(m_lock);
+				m_wake.wait(lock, [&]() { return !m_full.empty() || m_finished; });
+				if (m_full.empty())
+					break;
+				buffer = std::move(m_full.front());
+				m_full.pop_front();
+			}
+
+			// once stopped the buffers still go round so Take doesn't wait forever
+			if (!m_failed && !m_cancelled && !write(std::string_view(buffer.data.get(), buffer.size), false))
+				fail();
+
+			buffer.size = 0;
+			{
+				std::lock_guard lock(m_lock);
+				m_spare.push_back(std::move(buffer));
+			}
+			m_wake.notify_all();
+		}
+
+		if (!m_failed && !m_cancelled && !write({}, true))
+			fail();
+	}
+
+	PipeOutput::PipeOutput(ExportPipe& pipe) : m_pipe(pipe)
+	{
+		m_buffer = m_pipe.Take();
+		m_at = m_buffer.data.get();
+		m_end = m_at + ExportPipe::bufferBytes;
+	}
+
+	void PipeOutput::next()
+	{
+		m_buffer.size = size_t(m_at - m_buffer.data.get());
+		m_handed += m_buffer.size;
+		m_pipe.Put(std::move(m_buffer));
+		m_buffer = m_pipe.Take();
+		m_at = m_buffer.data.get();
+		m_end = m_at + ExportPipe::bufferBytes;
+	}
+
+	void PipeOutput::append(const char* data, size_t size)
+	{
+		while (size)
+		{
+			reserve(1);
+			const auto n = std::min(size, size_t(m_end - m_at));
+			std::memcpy(m_at, data, n);
+			m_at += n;
+			data += n;
+			size -= n;
+		}
+	}
+
+	void PipeOutput::Flush()
+	{
+		m_buffer.size = size_t(m_at - m_buffer.data.get());
+		if (m_buffer.size)
+		{
+			m_handed += m_buffer.size;
+			m_pipe.Put(std::move(m_buffer));
+			m_buffer = m_pipe.Take();
+		}
+		m_at = m_buffer.data.get();
+		m_end = m_at + ExportPipe::bufferBytes;
+	}
+
+	void TextFormatter::Text(std::string_view text)
+	{
+		const char* at = text.data();
+		const char* end = at + text.size();
+
+		if (m_csv)
+		{
+			// quoted only when needed, quotes inside doubled
+			const char* special = findSpecial(at, end, csvSpecial);
+			if (special == end)
+			{
+				append(at, text.size());
+				return;
+			}
+
+			reserve(1);
+			*m_at++ = '"';
+			while (at < end)
+			{
+				const char* quote = static_cast<const char*>(std::memchr(at, '"', size_t(end - at)));
+				const char* until = quote ? quote + 1 : end;
+				append(at, size_t(until - at));
+				if (quote)
+				{
+					reserve(1);
+					*m_at++ = '"';
+				}
+				at = until;
+			}
+			reserve(1);
+			*m_at++ = '"';
+			return;
+		}
+
+		while (at < end)
+		{
+			const char* special = findSpecial(at, end, tsvSpecial);
+			append(at, size_t(special - at));
+			if (special == end)
+				break;
+
+			reserve(2);
+			*m_at++ = '\\';
+			switch (*special)
+			{
+			case '\t': *m_at++ = 't'; break;
+			case '\n': *m_at++ = 'n'; break;
+			case '\r': *m_at++ = 'r'; break;
+			default: *m_at++ = '\\'; break;
+			}
+			at = special + 1;
+		}
+	}
+
+	void TextFormatter::Integer(int64_t value)
+	{
+		reserve(24);
+		m_at = std::to_chars(m_at, m_end, value).ptr;
+	}
+
+	void TextFormatter::Real(double value)
+	{
+		reserve(32);
+		m_at = std::to_chars(m_at, m_end, value).ptr;
+	}
+
+	ArrowType NarrowArrowType(ArrowType type, std::string_view text)
+	{
+		if (text.empty() || type == ArrowType::Utf8 || type == ArrowType::Dictionary)
+			return type;
+
+		const bool negative = text.front() == '-';
+		const auto digits = text.substr(negative ? 1 : 0);
+		const bool allDigits = !digits.empty() && std::all_of(digits.begin(), digits.end(), [](char c) { return unsigned(c - '0') < 10; });
+		// 007 and ids too long for an int64 or a double to hold exactly stay text
+		if (allDigits && (digits.size() > 18 || (digits[0] == '0' && digits.size() > 1)))
+			return ArrowType::Utf8;
+		if (allDigits && !(negative && digits == "0"))
+			return type;
+
+		double value;
+		const bool leadingZero = digits.size() > 1 && digits[0] == '0' && digits[1] != '.';
+		if (leadingZero || text.front() == ' ' || text.front() == '+' || text.back() == ' ' || !ParseNumber(text, value))
+			return ArrowType::Utf8;
+		return ArrowType::Float64;
+	}
+
+	ArrowWriter::ArrowWriter(ExportPipe& pipe, std::vector<ArrowColumn> columns) : PipeOutput(pipe), m_columns(std::move(columns)), m_builders(m_columns.size())
+	{
+		append("ARROW1\0\0", 8);
+		message(arrowMessage(headerSchema, 0, [&](FlatBuilder& builder, size_t slot) { writeSchema(builder, slot, m_columns); }), {});
+
+		// the values of each dictionary column, by code
+		for (size_t i = 0; i < m_columns.size(); ++i)
+		{
+			if (m_columns[i].type != ArrowType::Dictionary || !m_columns[i].dictionary)
+				continue;
+
+			const auto& dictionary = *m_columns[i].dictionary;
+			std::string offsets, data;
+			int32_t end = 0;
+			offsets.append(reinterpret_cast<const char*>(&end), sizeof(end));
+			for (const auto& value : dictionary)
+			{
+				data.append(value);
+				end = int32_t(data.size());
+				offsets.append(reinterpret_cast<const char*>(&end), sizeof(end));
+			}
+
+			BatchLayout layout;
+			layout.Node(dictionary.size(), 0);
+			layout.Buffer({});
+			layout.Buffer(offsets);
+			layout.Buffer(data);
+			auto metadata = arrowMessage(headerDictionaryBatch, layout.bodyLength, [&](FlatBuilder& builder, size_t slot)
+				{
+					auto refs = builder.Table(slot, { { 0, 8, i }, { 1, 4, 0, true }, { 2, 1, 0 } });
+					writeRecordBatch(builder, refs[0], dictionary.size(), layout);
+				});
+			m_dictionaries.push_back(message(metadata, layout.body));
+		}
+
+		for (size_t i = 0; i < m_columns.size(); ++i)
+		{
+			if (m_columns[i].type == ArrowType::Utf8)
+				m_builders[i].values.assign(sizeof(int32_t), '\0');
+		}
+	}
+
+	ArrowWriter::Block ArrowWriter::message(const std::string& metadata, const std::vector<std::string_view>& body)
+	{
+		static constexpr char zeros[8] = {};
+
+		// the continuation marker and the metadata's size, which FlatBuilder pads to 8 so the body starts aligned
+		Block ret;
+		ret.offset = Written();
+		const uint32_t prefix[2] = { 0xFFFFFFFF, uint32_t(metadata.size()) };
+		append(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+		append(metadata.data(), metadata.size());
+		ret.metaDataLength = uint32_t(sizeof(prefix) + metadata.size());
+
+		for (auto buffer : body)
+		{
+			append(buffer.data(), buffer.size());
+			append(zeros, pad8(buffer.size()) - buffer.size());
+		}
+		ret.bodyLength = Written() - ret.offset - ret.metaDataLength;
+		return ret;
+	}
+
+	void ArrowWriter::valid(Builder& builder, bool valid)
+	{
+		if (m_rows % 8 == 0)
+			builder.validity.push_back('\0');
+		if (valid)
+			builder.validity.back() = char(builder.validity.back() | (1 << (m_rows % 8)));
+		else
+			builder.nulls++;
+	}
+
+	void ArrowWriter::Text(std::string_view text)
+	{
+		const auto& column = m_columns[m_column];
+		auto& builder = m_builders[m_column];
+		switch (column.type)
+		{
+		case ArrowType::Int64:
+		{
+			// a value appended since the types were settled that doesn't fit is null
+			int64_t value = 0;
+			const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+			const bool ok = !text.empty() && error == std::errc() && end == text.data() + text.size();
+			valid(builder, ok);
+			value = ok ? value : 0;
+			builder.values.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			break;
+		}
+		case ArrowType::Float64:
+		{
+			double value = 0;
+			const bool ok = ParseNumber(text, value);
+			valid(builder, ok);
+			value = ok ? value : 0;
+			builder.values.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			break;
+		}
+		case ArrowType::Utf8:
+		{
+			valid(builder, !text.empty());
+			builder.data.append(text);
+			const auto end = int32_t(builder.data.size());
+			builder.values.append(reinterpret_cast<const char*>(&end), sizeof(end));
+			m_bytes += text.size();
+			break;
+		}
+		case ArrowType::Dictionary:
+		{
+			// only codes come for these
+			const int32_t code = 0;
+			valid(builder, false);
+			builder.values.append(reinterpret_cast<const char*>(&code), sizeof(code));
+			break;
+		}
+		}
+	}
+
+	void ArrowWriter::Integer(int64_t value)
+	{
+		const auto& column = m_columns[m_column];
+		auto& builder = m_builders[m_column];
+		if (column.dictionary)
+		{
+			const bool known = value >= 0 && value < int64_t(column.dictionary->size());
+			if (column.type != ArrowType::Dictionary)
+			{
+				Text(known ? std::string_view((*column.dictionary)[size_t(value)]) : std::string_view());
+				return;
+			}
+
+			const auto code = int32_t(known ? value : 0);
+			valid(builder, known && !(*column.dictionary)[size_t(value)].empty());
+			builder.values.append(reinterpret_cast<const char*>(&code), sizeof(code));
+			return;
+		}
+
+		switch (column.type)
+		{
+		case ArrowType::Int64:
+			valid(builder, true);
+			builder.values.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			break;
+		case ArrowType::Float64:
+		{
+			const auto real = double(value);
+			valid(builder, true);
+			builder.values.append(reinterpret_cast<const char*>(&real), sizeof(real));
+			break;
+		}
+		default:
+		{
+			char number[32];
+			Text(std::string_view(number, size_t(std::to_chars(number, number + sizeof(number), value).ptr - number)));
+			break;
+		}
+		}
+	}
+
+	void ArrowWriter::Real(double value)
+	{
+		auto& builder = m_builders[m_column];
+		switch (m_columns[m_column].type)
+		{
+		case ArrowType::Float64:
+			valid(builder, true);
+			builder.values.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			break;
+		case ArrowType::Int64:
+		{
+			const bool whole = value == std::trunc(value) && std::abs(value) < 9e18;
+			const auto integer = whole ? int64_t(value) : 0;
+			valid(builder, whole);
+			builder.values.append(reinterpret_cast<const char*>(&integer), sizeof(integer));
+			break;
+		}
+		default:
+		{
+			char number[32];
+			Text(std::string_view(number, size_t(std::to_chars(number, number + sizeof(number), value).ptr - number)));
+			break;
+		}
+		}
+	}
+
+	void ArrowWriter::EndCell(bool last)
+	{
+		if (!last)
+		{
+			m_column++;
+			return;
+		}
+
+		m_column = 0;
+		if (++m_rows == batchRows || m_bytes >= batchBytes)
+			batch();
+	}
+
+	void ArrowWriter::batch()
+	{
+		// a column without nulls leaves its validity buffer out
+		BatchLayout layout;
+		for (size_t i = 0; i < m_columns.size(); ++i)
+		{
+			const auto& builder = m_builders[i];
+			layout.Node(m_rows, builder.nulls);
+			layout.Buffer(builder.nulls ? std::string_view(builder.validity) : std::string_view());
+			layout.Buffer(builder.values);
+			if (m_columns[i].type == ArrowType::Utf8)
+				layout.Buffer(builder.data);
+		}
+
+		auto metadata = arrowMessage(headerRecordBatch, layout.bodyLength, [&](FlatBuilder& builder, size_t slot) { writeRecordBatch(builder, slot, m_rows, layout); });
+		m_batches.push_back(message(metadata, layout.body));
+
+		for (size_t i = 0; i < m_columns.size(); ++i)
+		{
+			auto& builder = m_builders[i];
+			builder.validity.clear();
+			builder.values.clear();
+			builder.data.clear();
+			builder.nulls = 0;
+			if (m_columns[i].type == ArrowType::Utf8)
+				builder.values.assign(sizeof(int32_t), '\0');
+		}
+		m_rows = 0;
+		m_bytes = 0;
+	}
+
+	void ArrowWriter::Finish()
+	{
+		if (m_rows)
+			batch();
+
+		// end of stream, then the footer with the schema again and where the batches are
+		const uint32_t end[2] = { 0xFFFFFFFF, 0 };
+		append(reinterpret_cast<const char*>(end), sizeof(end));
+
+		auto blocks = [](const std::vector<Block>& from)
+			{
+				// offset, metadata length padded to 8, body length
+				std::string ret;
+				for (const auto& block : from)
+				{
+					const int64_t fields[3] = { int64_t(block.offset), int64_t(block.metaDataLength), int64_t(block.bodyLength) };
+					ret.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+				}
+				return ret;
+			};
+
+		FlatBuilder builder;
+		auto refs = builder.Table(builder.Root(), { { 0, 2, arrowVersion }, { 1, 4, 0, true }, { 2, 4, 0, true }, { 3, 4, 0, true } });
+		writeSchema(builder, refs[0], m_columns);
+		const auto dictionaries = blocks(m_dictionaries);
+		const auto batches = blocks(m_batches);
+		builder.Structs(refs[1], dictionaries.data(), m_dictionaries.size(), 24);
+		builder.Structs(refs[2], batches.data(), m_batches.size(), 24);
+		const auto footer = builder.Finish();
+
+		append(footer.data(), footer.size());
+		const auto size = int32_t(footer.size());
+		append(reinterpret_cast<const char*>(&size), sizeof(size));
+		append("ARROW1", 6);
+		Flush();
+	}
+}
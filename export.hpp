@@ -0,0 +1,219 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace data
+{
+	// takes the next piece of an export, false stops it as failed
+	using fnWrite = std::function<bool(std::string_view)>;
+
+	enum class ExportFormat
+	{
+		// tabs, line breaks and backslashes escaped so every row is one line
+		Tsv,
+		// RFC 4180, fields with commas, quotes or line breaks quoted
+		Csv,
+		// Arrow IPC file, also known as Feather v2, typed columns in record batches
+		Arrow,
+	};
+
+	struct ExportOptions
+	{
+		ExportFormat format = ExportFormat::Tsv;
+		// one zstd frame around the whole output, ignored for Arrow and unless CanCompressExports
+		bool compress = false;
+	};
+
+	// built with GUI4LIFE_ZSTD defined and libzstd linked
+	bool CanCompressExports();
+
+	// Buffers of output on their way to fnOut on a thread of their own, so filling the next one overlaps writing the last.
+	// No more than buffers of them exist, Take waits for the writer once they are all in use. Compressed on the way when asked.
+	class ExportPipe
+	{
+	public:
+		static constexpr size_t bufferBytes = 4 * 1024 * 1024;
+		static constexpr size_t buffers = 3;
+
+		struct Buffer
+		{
+			std::unique_ptr<char[]> data;
+			size_t size = 0;
+		};
+
+	private:
+		const fnWrite& m_out;
+		std::atomic<bool>& m_failed;
+		const std::atomic<bool>& m_cancelled;
+		std::function<void()> m_onFailed;
+
+		std::mutex m_lock;
+		std::condition_variable m_wake;
+		std::deque<Buffer> m_full;
+		std::vector<Buffer> m_spare;
+		size_t m_allocated = 0;
+		bool m_finished = false;
+
+		// a ZSTD_CCtx and where it compresses to, unused without GUI4LIFE_ZSTD
+		void* m_zstd = nullptr;
+		std::unique_ptr<char[]> m_compressed;
+
+		std::thread m_thread;
+
+		bool write(std::string_view piece, bool last);
+		void run();
+
+	public:
+		// onFailed is called on the writer thread when fnOut fails, to stop whatever fills the buffers
+		ExportPipe(const fnWrite& out, bool compress, std::atomic<bool>& failed, const std::atomic<bool>& cancelled, std::function<void()> onFailed);
+		~ExportPipe();
+
+		ExportPipe(const ExportPipe&) = delete;
+		ExportPipe& operator=(const ExportPipe&) = delete;
+
+		// an empty buffer of bufferBytes
+		Buffer Take();
+		// queues buffer.size bytes of it for writing
+		void Put(Buffer buffer);
+		// writes what is queued, ends the compressed frame and waits for the writer
+		void Finish();
+	};
+
+	// Bytes written straight into the pipe's buffers, each full one handed over and the next taken
+	class PipeOutput
+	{
+	protected:
+		ExportPipe& m_pipe;
+		ExportPipe::Buffer m_buffer;
+		char* m_at = nullptr;
+		char* m_end = nullptr;
+		// in the buffers handed over so far
+		uint64_t m_handed = 0;
+
+		// room for n more bytes, n small
+		void reserve(size_t n)
+		{
+			if (size_t(m_end - m_at) < n)
+				next();
+		}
+		void next();
+		void append(const char* data, size_t size);
+
+	public:
+		explicit PipeOutput(ExportPipe& pipe);
+
+		PipeOutput(const PipeOutput&) = delete;
+		PipeOutput& operator=(const PipeOutput&) = delete;
+
+		uint64_t Written() const { return m_handed + uint64_t(m_at - m_buffer.data.get()); }
+		// hands the buffer filled so far to the pipe
+		void Flush();
+	};
+
+	// Cells of rows as TSV or CSV. Text is copied in runs between the characters that need escaping or quoting,
+	// numbers are written in place.
+	class TextFormatter : public PipeOutput
+	{
+	private:
+		const bool m_csv;
+
+	public:
+		TextFormatter(ExportPipe& pipe, ExportFormat format) : PipeOutput(pipe), m_csv(format == ExportFormat::Csv) {}
+
+		void Text(std::string_view text);
+		void Integer(int64_t value);
+		void Real(double value);
+		// after every cell, last ends the row
+		void EndCell(bool last)
+		{
+			reserve(1);
+			*m_at++ = last ? '\n' : m_csv ? ',' : '\t';
+		}
+	};
+
+	enum class ArrowType
+	{
+		Int64,
+		Float64,
+		Utf8,
+		// utf8 values by int32 code, written once per file
+		Dictionary,
+	};
+
+	// What a column of text can be stored as once text is one of its values: Int64 while every value is a plain
+	// integer, Float64 while every value is a number, Utf8 otherwise. Empty text is null and narrows nothing,
+	// numbers with leading zeros or spaces stay text so nothing written is lost.
+	ArrowType NarrowArrowType(ArrowType type, std::string_view text);
+
+	struct ArrowColumn
+	{
+		std::string name;
+		ArrowType type = ArrowType::Utf8;
+		// cells of the column come as codes into it, Int64 and Float64 ones are parsed from the value
+		const std::vector<std::string>* dictionary = nullptr;
+	};
+
+	// An Arrow IPC file, Feather v2: the schema, a dictionary batch per dictionary column, record batches and the
+	// footer indexing them. Empty text is null in every column. Buffers are 8 byte aligned, so readers can map the
+	// file instead of parsing it. Rows are collected column by column into the batch being filled, which goes out
+	// after batchRows rows or batchBytes of values, so memory stays bounded whatever the number of rows.
+	class ArrowWriter : public PipeOutput
+	{
+	public:
+		static constexpr size_t batchRows = 65536;
+		static constexpr size_t batchBytes = 64 * 1024 * 1024;
+
+	private:
+		struct Block
+		{
+			uint64_t offset = 0;
+			uint32_t metaDataLength = 0;
+			uint64_t bodyLength = 0;
+		};
+
+		// validity bits, fixed width values or int32 offsets, utf8 bytes
+		struct Builder
+		{
+			std::string validity;
+			std::string values;
+			std::string data;
+			size_t nulls = 0;
+		};
+
+		std::vector<ArrowColumn> m_columns;
+		std::vector<Builder> m_builders;
+		size_t m_column = 0;
+		size_t m_rows = 0;
+		size_t m_bytes = 0;
+		std::vector<Block> m_dictionaries;
+		std::vector<Block> m_batches;
+
+		void valid(Builder& builder, bool valid);
+		// an encapsulated message, metadata and body padded to 8 bytes
+		Block message(const std::string& metadata, const std::vector<std::string_view>& body);
+		void batch();
+
+	public:
+		// writes the schema and dictionaries
+		ArrowWriter(ExportPipe& pipe, std::vector<ArrowColumn> columns);
+
+		void Text(std::string_view text);
+		void Integer(int64_t value);
+		void Real(double value);
+		// after every cell, last ends the row
+		void EndCell(bool last);
+		// writes the last batch and the footer, and flushes
+		void Finish();
+	};
+}
@@ -1,916 +1,1919 @@
-#include <windows.h>
-#include <iostream>
-
-#include "imgui.h"
-#include "imgui_impl_win32.h"
-#include "imgui_impl_dx12.h"
-
-#include <d3d12.h>
-#include <dxgi1_4.h>
-
-#include "tsvdata.hpp"
-#include "config.hpp"
-
-#ifdef _DEBUG
-#define DX12_ENABLE_DEBUG_LAYER
-#endif
-
-
-#ifdef DX12_ENABLE_DEBUG_LAYER
-#include <dxgidebug.h>
-#pragma comment(lib, "dxguid.lib")
-#endif
-
-namespace
-{
-	// Config for example app
-	static const int APP_NUM_FRAMES_IN_FLIGHT = 2;
-	static const int APP_NUM_BACK_BUFFERS = 2;
-	static const int APP_SRV_HEAP_SIZE = 64;
-
-	struct FrameContext
-	{
-		ID3D12CommandAllocator* CommandAllocator;
-		UINT64                      FenceValue;
-	};
-
-	// Simple free list based allocator
-	struct ExampleDescriptorHeapAllocator
-	{
-		ID3D12DescriptorHeap* Heap = nullptr;
-		D3D12_DESCRIPTOR_HEAP_TYPE  HeapType = D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES;
-		D3D12_CPU_DESCRIPTOR_HANDLE HeapStartCpu;
-		D3D12_GPU_DESCRIPTOR_HANDLE HeapStartGpu;
-		UINT                        HeapHandleIncrement;
-		ImVector<int>               FreeIndices;
-
-		void Create(ID3D12Device* device, ID3D12DescriptorHeap* heap)
-		{
-			IM_ASSERT(Heap == nullptr && FreeIndices.empty());
-			Heap = heap;
-			D3D12_DESCRIPTOR_HEAP_DESC desc = heap->GetDesc();
-			HeapType = desc.Type;
-			HeapStartCpu = Heap->GetCPUDescriptorHandleForHeapStart();
-			HeapStartGpu = Heap->GetGPUDescriptorHandleForHeapStart();
-			HeapHandleIncrement = device->GetDescriptorHandleIncrementSize(HeapType);
-			FreeIndices.reserve((int)desc.NumDescriptors);
-			for (int n = desc.NumDescriptors; n > 0; n--)
-				FreeIndices.push_back(n - 1);
-		}
-		void Destroy()
-		{
-			Heap = nullptr;
-			FreeIndices.clear();
-		}
-		void Alloc(D3D12_CPU_DESCRIPTOR_HANDLE* out_cpu_desc_handle, D3D12_GPU_DESCRIPTOR_HANDLE* out_gpu_desc_handle)
-		{
-			IM_ASSERT(FreeIndices.Size > 0);
-			int idx = FreeIndices.back();
-			FreeIndices.pop_back();
-			out_cpu_desc_handle->ptr = HeapStartCpu.ptr + (idx * HeapHandleIncrement);
-			out_gpu_desc_handle->ptr = HeapStartGpu.ptr + (idx * HeapHandleIncrement);
-		}
-		void Free(D3D12_CPU_DESCRIPTOR_HANDLE out_cpu_desc_handle, D3D12_GPU_DESCRIPTOR_HANDLE out_gpu_desc_handle)
-		{
-			int cpu_idx = (int)((out_cpu_desc_handle.ptr - HeapStartCpu.ptr) / HeapHandleIncrement);
-			int gpu_idx = (int)((out_gpu_desc_handle.ptr - HeapStartGpu.ptr) / HeapHandleIncrement);
-			IM_ASSERT(cpu_idx == gpu_idx);
-			FreeIndices.push_back(cpu_idx);
-		}
-	};
-
-	// Data
-	FrameContext                 g_frameContext[APP_NUM_FRAMES_IN_FLIGHT] = {};
-	UINT                         g_frameIndex = 0;
-
-	ID3D12Device*					g_pd3dDevice = nullptr;
-	ID3D12DescriptorHeap*			g_pd3dRtvDescHeap = nullptr;
-	ID3D12DescriptorHeap*			g_pd3dSrvDescHeap = nullptr;
-	ExampleDescriptorHeapAllocator	g_pd3dSrvDescHeapAlloc;
-	ID3D12CommandQueue*				g_pd3dCommandQueue = nullptr;
-	ID3D12GraphicsCommandList*		g_pd3dCommandList = nullptr;
-	ID3D12Fence*					g_fence = nullptr;
-	HANDLE							g_fenceEvent = nullptr;
-	UINT64							g_fenceLastSignaledValue = 0;
-	IDXGISwapChain3*				g_pSwapChain = nullptr;
-	bool							g_SwapChainOccluded = false;
-	HANDLE							g_hSwapChainWaitableObject = nullptr;
-	ID3D12Resource*					g_mainRenderTargetResource[APP_NUM_BACK_BUFFERS] = {};
-	D3D12_CPU_DESCRIPTOR_HANDLE		g_mainRenderTargetDescriptor[APP_NUM_BACK_BUFFERS] = {};
-
-	// Forward declarations of helper functions
-	bool CreateDeviceD3D(HWND hWnd);
-	void CleanupDeviceD3D();
-	void CreateRenderTarget();
-	void CleanupRenderTarget();
-	void WaitForLastSubmittedFrame();
-	FrameContext* WaitForNextFrameResources();
-	LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
-
-}
-
-
-extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
-
-namespace
-{
-	LRESULT WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
-	{
-		if (ImGui_ImplWin32_WndProcHandler(hWnd, msg, wParam, lParam))
-			return true;
-
-		switch (msg)
-		{
-		case WM_SIZE:
-			if (g_pd3dDevice != nullptr && wParam != SIZE_MINIMIZED)
-			{
-				WaitForLastSubmittedFrame();
-				CleanupRenderTarget();
-				HRESULT result = g_pSwapChain->ResizeBuffers(0, (UINT)LOWORD(lParam), (UINT)HIWORD(lParam), DXGI_FORMAT_UNKNOWN, DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT);
-				assert(SUCCEEDED(result) && "Failed to resize swapchain.");
-				CreateRenderTarget();
-			}
-			return 0;
-		case WM_SYSCOMMAND:
-			if ((wParam & 0xfff0) == SC_KEYMENU) // Disable ALT application menu
-				return 0;
-			break;
-		case WM_DESTROY:
-			::PostQuitMessage(0);
-			return 0;
-		}
-
-		return ::DefWindowProcW(hWnd, msg, wParam, lParam);
-	}
-
-
-	std::atomic_bool s_exiting(false);
-
-	struct View
-	{
-		bool visible = false;
-		std::string sorts;
-
-		/*
-						ImGuiSelectableFlags selectable_flags = (contents_type == CT_SelectableSpanRow) ? ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap : ImGuiSelectableFlags_None;
-						if (ImGui::Selectable(label, item_is_selected, selectable_flags, ImVec2(0, row_min_height)))
-		*/
-		ImVector<int> selection;
-
-		int select_from = -1;
-		int select_to = -1;
-	};
-
-	struct ViewState
-	{
-		std::unordered_map<std::string, View> views;
-	};
-
-	std::unordered_map<std::string, ViewState> m_state;
-
-	ViewState& getViewState(data::DbDataSet& db)
-	{
-		auto [path, pattern] = db.GetPath();
-		static std::string key;
-		key.clear();
-		key.reserve(path.size() + pattern.size());
-		key.append(path).append(pattern);
-		return m_state[key];
-	}
-
-	constexpr int DefaultWidth = 1280;
-	constexpr int DefaultHeight = 800;
-
-	std::unordered_map<std::string, std::unique_ptr<data::DbDataSet>> s_data;
-
-	std::unordered_map<std::string, bool> s_opened;
-
-	config::Config s_config;
-
-	void logMsg(const std::string& msg)
-	{
-		std::cout << msg;
-	}
-
-	void DrawTableView(data::DbDataSet& db, const data::DbTableMetaData& table, bool* opened)
-	{
-		ImGui::SetNextWindowSize(ImVec2(1024, 768), ImGuiCond_Once);
-
-		if (!ImGui::Begin(table.table_name.c_str(), opened, 0))
-		{
-			ImGui::End();
-			return;
-		}
-
-		ImGuiTableFlags flags =
-			ImGuiTableFlags_Resizable | ImGuiTableFlags_Reorderable | ImGuiTableFlags_Hideable | ImGuiTableFlags_Sortable
-			| ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_NoBordersInBody
-			| ImGuiTableFlags_ScrollY | ImGuiTableFlags_ScrollX;
-
-		std::string table_view_name = table.table_name;
-		table_view_name.append("_data");
-
-		static const float TEXT_BASE_WIDTH = ImGui::CalcTextSize("A").x;
-		static const float TEXT_BASE_HEIGHT = ImGui::GetTextLineHeightWithSpacing();
-
-		int initHeight = table.count > 30 ? 30 : int(table.count);
-		int initWidth = table.columns.size() > 50 ? 50 : int(table.columns.size());
-
-		ViewState& viewState = getViewState(db);
-
-		if (ImGui::BeginTable(table_view_name.c_str(), int(table.columns.size()), flags, ImVec2(0, 0/*initHeight * (TEXT_BASE_HEIGHT + 5)*/), 0/*initWidth * TEXT_BASE_WIDTH * 10*/))
-		{
-			View& view = viewState.views[table_view_name];
-
-			int i = 0;
-			for (const auto& col : table.columns)
-			{
-				ImGui::TableSetupColumn(col.c_str(), (i++ == 0 ? ImGuiTableColumnFlags_NoReorder | ImGuiTableColumnFlags_NoHide : ImGuiTableColumnFlags_None));
-			}
-
-			ImGui::TableSetupScrollFreeze(1, 1); // Make row always visible
-			ImGui::TableHeadersRow();
-
-			ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs();
-
-			if (sort_specs && sort_specs->SpecsDirty)
-			{
-				std::string& sort = view.sorts;
-
-				sort.clear();
-
-				for (int i = 0; i < sort_specs->SpecsCount; ++i)
-				{
-					const auto spec = sort_specs->Specs[i];
-					assert(spec.ColumnIndex < table.columns.size());
-
-					sort.append(table.columns[spec.ColumnIndex]);
-					if (spec.SortDirection == ImGuiSortDirection_Ascending)
-						sort.append(" ASC, ");
-					else
-						sort.append(" DESC, ");
-				}
-
-				if (sort_specs->SpecsCount)
-					sort.resize(sort.size() - 2);
-
-				view.selection.resize(0);
-				view.select_to = -1;
-				view.select_from = -1;
-				sort_specs->SpecsDirty = false;
-			}
-
-			ImGuiListClipper clipper;
-			clipper.Begin(int(table.count));
-			while (clipper.Step())
-			{
-				auto start = clipper.DisplayStart;
-				auto end = clipper.DisplayEnd;
-
-				bool will_range_select = false;
-				bool range_selecting = false;
-
-				db.GetRows(table, viewState.views[table_view_name].sorts, [&](const std::vector<data::DbDataSet::ValType>& data)
-					{
-						int id = std::get<int>(data[0]);
-
-						auto& selection = view.selection;
-
-						if (!will_range_select)
-						{
-							if (!range_selecting && (id == view.select_from || id == view.select_to))
-								range_selecting = true;
-							else if (range_selecting && (id == view.select_to || id == view.select_from))
-							{
-								range_selecting = false;
-								selection.push_back(id);
-								view.select_from = -1;
-								view.select_to = -1;
-							}
-						}
-
-						if (range_selecting)
-						{
-							if (!selection.contains(id))
-							{
-								selection.push_back(id);
-							}
-						}
-
-						const bool item_is_selected = selection.contains(id);
-
-						ImGui::PushID(id);
-						ImGui::TableNextRow();
-
-						ImGuiSelectableFlags selectable_flags = ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap;
-
-
-						ImGui::TableNextColumn();
-						char label[32];
-						sprintf_s(label, std::extent<decltype(label)>(), "%d", id);
-						if (ImGui::Selectable(label, item_is_selected, selectable_flags))
-						{
-							if (ImGui::GetIO().KeyCtrl)
-							{
-								if (item_is_selected)
-									selection.find_erase_unsorted(id);
-								else
-									selection.push_back(id);
-							}
-							else if (ImGui::GetIO().KeyShift)
-							{
-								if (view.select_to == -1)
-								{
-									view.select_from = selection.empty() ? 0 : selection.back();
-									view.select_to = id;
-									will_range_select = true;
-								}
-							}
-							else
-							{
-								selection.clear();
-								selection.push_back(id);
-							}
-						}
-
-						//ImGui::Text("%d", std::get<int>(data[0]));
-						for (auto it = data.begin() + 1; it != data.end(); ++it)
-						{
-							ImGui::TableNextColumn();
-
-							const auto& str = std::get<std::string>(*it);
-
-							ImGui::TextUnformatted(str.c_str());
-						}
-						ImGui::PopID();
-					}, logMsg, end, start);
-			}
-
-			ImGui::EndTable();
-		}
-
-
-		ImGui::End();
-	}
-
-	void DrawHistoryWindow()
-	{
-		if (!ImGui::Begin("History", 0, ImGuiWindowFlags_NoDocking))
-		{
-			ImGui::End();
-			return;
-		}
-
-		static std::string add;
-		if (add.size() < 255)
-			add.resize(255);
-
-		if (ImGui::InputText("path", add.data(), int(add.size()), ImGuiInputTextFlags_EnterReturnsTrue))
-		{
-			std::string add_config(add.begin(), add.begin() + strlen(add.c_str()));
-
-			s_config.HistoryAdd(add_config);
-			add[0] = '\0';
-			add.clear();
-		}
-
-		ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImGui::ColorConvertU32ToFloat4(0xFF0000FF));
-
-		std::vector<int> erase;
-
-		s_config.HistoryGet([&](int id, const char* hData)
-			{
-				std::string history(hData);
-				ImGui::PushID(id);
-				if (ImGui::SmallButton("X"))
-				{
-					erase.push_back(id);
-					ImGui::PopID();
-					return;
-				}
-				ImGui::SameLine();
-				if (ImGui::SmallButton(hData))
-				{
-					if (s_data.count(history))
-					{
-						if (s_opened.count(history) && !s_opened[history])
-						{
-							s_opened[history] = true;
-						}
-						else
-						{
-							s_opened[history] = false;
-						}
-					}
-					else
-					{
-						try
-						{
-							s_data[history] = std::make_unique<data::DbDataSet>();
-							s_data[history]->LoadFromPath(hData, ".txt", logMsg);
-							s_opened[history] = true;
-						}
-						catch (...)
-						{
-							erase.push_back(id);
-						}
-					}
-				}
-				ImGui::PopID();
-			});
-
-		for (const auto& id : erase)
-		{
-			s_config.HistoryRem(id);
-		}
-
-		ImGui::PopStyleColor();
-		ImGui::End();
-	}
-
-	void DrawMetaWindow(data::DbDataSet& db, bool* opened)
-	{
-		if (opened && !*opened)
-			return;
-
-		static std::string name;
-
-		name.clear();
-		name.append("DB - ");
-		name.append(std::get<0>(db.GetPath()));
-
-		if (!ImGui::Begin(name.c_str(), opened, ImGuiWindowFlags_NoDocking))
-		{
-			ImGui::End();
-			return;
-		}
-
-
-		ImGui::PushStyleColor(ImGuiCol_Button, ImGui::ColorConvertU32ToFloat4(0x000000FF));
-		ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImGui::ColorConvertU32ToFloat4(0xFF0000FF));
-		ImGui::TextUnformatted("Path:");
-		ImGui::SameLine();
-		ImGui::SmallButton(std::get<0>(db.GetPath()).c_str());
-		ImGui::PopStyleColor();
-		ImGui::PopStyleColor();
-		ImGui::Spacing();
-		ImGui::Spacing();
-
-		ImGuiTreeNodeFlags base_flags = ImGuiTreeNodeFlags_DrawLinesFull | ImGuiTreeNodeFlags_DefaultOpen;
-		if (ImGui::TreeNodeEx("Tables", base_flags))
-		{
-			ImGuiTreeNodeFlags child_flags = ImGuiTreeNodeFlags_DrawLinesFull;
-
-			const auto& meta = db.GetTableMetaData();
-
-			ViewState& viewState = getViewState(db);
-
-			for (const auto& tab : meta.tables)
-			{
-				static std::stringstream name;
-
-				name.str("");
-				name.clear();
-				name << tab.table_name << " (" << tab.count << ")";
-
-				if (ImGui::TreeNodeEx(name.str().c_str(), child_flags))
-				{
-					if (ImGui::Button("table"))
-					{
-						viewState.views[tab.table_name].visible = (!viewState.views.count(tab.table_name) || !viewState.views[tab.table_name].visible) ? true : false;
-					}
-
-					if (viewState.views[tab.table_name].visible)
-					{
-						DrawTableView(db, tab, &viewState.views[tab.table_name].visible);
-					}
-
-
-					ImGui::Text(tab.file_name.c_str());
-
-					name.str("");
-					name.clear();
-					name << "columns (" << tab.columns.size() << ")";
-					if (ImGui::TreeNodeEx(name.str().c_str(), child_flags))
-					{
-						for (const auto& col : tab.columns)
-						{
-							ImGui::Text(col.c_str());
-						}
-						ImGui::TreePop();
-					}
-					ImGui::TreePop();
-				}
-
-			}
-
-			ImGui::TreePop();
-		}
-
-		ImGui::End();
-	}
-}
-
-void DrawDataWindows()
-{
-	for (const auto& data : s_data)
-	{
-		auto& [key, pData] = data;
-		if (s_opened.count(key) && s_opened[key])
-		{
-			auto& flag = s_opened[key];
-			DrawMetaWindow(*std::get<1>(data), &flag);
-		}
-	}
-}
-
-int main(int argc, char* argv[])
-{
-	std::string configP("config.db");
-
-	for (int i = 1; i < argc; i++)
-	{
-		if (_stricmp("-config",argv[i]) == 0)
-		{
-			if (i + 1 < argc)
-			{
-				configP = argv[i + 1];
-				i++;
-			}
-		}
-	}
-
-	std::filesystem::path cfg_path(configP);
-
-	if (!s_config.CreatePaths(cfg_path))
-	{
-		std::cout << "Failed to create config database path: " << cfg_path.parent_path() << "\n";
-		return 1;
-	}
-
-	s_config.Load(configP);
-
-	//s_data = std::make_unique<data::DbDataSet>();
-	//s_data->LoadFromPath(datapath.c_str(), ".txt", logMsg);
-
-	ImGui_ImplWin32_EnableDpiAwareness();
-	float main_scale = ImGui_ImplWin32_GetDpiScaleForMonitor(::MonitorFromPoint(POINT{ 0, 0 }, MONITOR_DEFAULTTOPRIMARY));
-
-	// Create application window
-	WNDCLASSEXW wc = { sizeof(wc), CS_CLASSDC, WndProc, 0L, 0L, GetModuleHandle(nullptr), nullptr, nullptr, nullptr, nullptr, L"Gui4Life", nullptr };
-	::RegisterClassExW(&wc);
-	HWND hwnd = ::CreateWindowW(wc.lpszClassName, L"Gui4Life", WS_OVERLAPPEDWINDOW, 100, 100, (int)(DefaultWidth * main_scale), (int)(DefaultHeight * main_scale), nullptr, nullptr, wc.hInstance, nullptr);
-
-	// Initialize Direct3D
-	if (!CreateDeviceD3D(hwnd))
-	{
-		CleanupDeviceD3D();
-		::UnregisterClassW(wc.lpszClassName, wc.hInstance);
-		return 1;
-	}
-
-	::ShowWindow(hwnd, SW_SHOWDEFAULT);
-	::UpdateWindow(hwnd);
-
-
-	// Setup Dear ImGui context
-	IMGUI_CHECKVERSION();
-	ImGui::CreateContext();
-	ImGuiIO& io = ImGui::GetIO(); (void)io;
-	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
-	io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
-	io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;         // Enable Docking
-	io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;       // Enable Multi-Viewport / Platform Windows
-
-	ImGui::StyleColorsDark();
-
-	// Setup scaling
-	ImGuiStyle& style = ImGui::GetStyle();
-	style.ScaleAllSizes(main_scale);        // Bake a fixed style scale. (until we have a solution for dynamic style scaling, changing this requires resetting Style + calling this again)
-	style.FontScaleDpi = main_scale;        // Set initial font scale. (using io.ConfigDpiScaleFonts=true makes this unnecessary. We leave both here for documentation purpose)
-	io.ConfigDpiScaleFonts = true;          // [Experimental] Automatically overwrite style.FontScaleDpi in Begin() when Monitor DPI changes. This will scale fonts but _NOT_ scale sizes/padding for now.
-	io.ConfigDpiScaleViewports = true;      // [Experimental] Scale Dear ImGui and Platform Windows when Monitor DPI changes.
-
-	// When viewports are enabled we tweak WindowRounding/WindowBg so platform windows can look identical to regular ones.
-	if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
-	{
-		style.WindowRounding = 0.0f;
-		style.Colors[ImGuiCol_WindowBg].w = 1.0f;
-	}
-
-	// Setup Platform/Renderer backends
-	ImGui_ImplWin32_Init(hwnd);
-
-	ImGui_ImplDX12_InitInfo init_info = {};
-	init_info.Device = g_pd3dDevice;
-	init_info.CommandQueue = g_pd3dCommandQueue;
-	init_info.NumFramesInFlight = APP_NUM_FRAMES_IN_FLIGHT;
-	init_info.RTVFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
-	init_info.DSVFormat = DXGI_FORMAT_UNKNOWN;
-	// Allocating SRV descriptors (for textures) is up to the application, so we provide callbacks.
-	// (current version of the backend will only allocate one descriptor, future versions will need to allocate more)
-	init_info.SrvDescriptorHeap = g_pd3dSrvDescHeap;
-	init_info.SrvDescriptorAllocFn = [](ImGui_ImplDX12_InitInfo*, D3D12_CPU_DESCRIPTOR_HANDLE* out_cpu_handle, D3D12_GPU_DESCRIPTOR_HANDLE* out_gpu_handle) { return g_pd3dSrvDescHeapAlloc.Alloc(out_cpu_handle, out_gpu_handle); };
-	init_info.SrvDescriptorFreeFn = [](ImGui_ImplDX12_InitInfo*, D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle, D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle) { return g_pd3dSrvDescHeapAlloc.Free(cpu_handle, gpu_handle); };
-	ImGui_ImplDX12_Init(&init_info);
-
-	bool show_demo_window = false;
-	bool show_another_window = false;
-	ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
-
-	while (!s_exiting)
-	{
-		MSG msg;
-		while (::PeekMessage(&msg, nullptr, 0U, 0U, PM_REMOVE))
-		{
-			::TranslateMessage(&msg);
-			::DispatchMessage(&msg);
-			if (msg.message == WM_QUIT)
-				s_exiting = true;
-		}
-		if (s_exiting)
-			break;
-
-		// Handle window screen locked
-		if ((g_SwapChainOccluded && g_pSwapChain->Present(0, DXGI_PRESENT_TEST) == DXGI_STATUS_OCCLUDED) || ::IsIconic(hwnd))
-		{
-			::Sleep(10);
-			continue;
-		}
-		g_SwapChainOccluded = false;
-
-		// Start the Dear ImGui frame
-		ImGui_ImplDX12_NewFrame();
-		ImGui_ImplWin32_NewFrame();
-		ImGui::NewFrame();
-
-		if (show_demo_window)
-			ImGui::ShowDemoWindow(&show_demo_window);
-
-		DrawHistoryWindow();
-		DrawDataWindows();
-
-		ImGui::Render();
-
-		FrameContext* frameCtx = WaitForNextFrameResources();
-		UINT backBufferIdx = g_pSwapChain->GetCurrentBackBufferIndex();
-		frameCtx->CommandAllocator->Reset();
-
-		D3D12_RESOURCE_BARRIER barrier = {};
-		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-		barrier.Transition.pResource = g_mainRenderTargetResource[backBufferIdx];
-		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-		g_pd3dCommandList->Reset(frameCtx->CommandAllocator, nullptr);
-		g_pd3dCommandList->ResourceBarrier(1, &barrier);
-
-		// Render Dear ImGui graphics
-		const float clear_color_with_alpha[4] = { clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w };
-		g_pd3dCommandList->ClearRenderTargetView(g_mainRenderTargetDescriptor[backBufferIdx], clear_color_with_alpha, 0, nullptr);
-		g_pd3dCommandList->OMSetRenderTargets(1, &g_mainRenderTargetDescriptor[backBufferIdx], FALSE, nullptr);
-		g_pd3dCommandList->SetDescriptorHeaps(1, &g_pd3dSrvDescHeap);
-		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), g_pd3dCommandList);
-		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-		g_pd3dCommandList->ResourceBarrier(1, &barrier);
-		g_pd3dCommandList->Close();
-
-		g_pd3dCommandQueue->ExecuteCommandLists(1, (ID3D12CommandList* const*)&g_pd3dCommandList);
-
-		// Update and Render additional Platform Windows
-		if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
-		{
-			ImGui::UpdatePlatformWindows();
-			ImGui::RenderPlatformWindowsDefault();
-		}
-
-		// Present
-		HRESULT hr = g_pSwapChain->Present(1, 0);   // Present with vsync
-		//HRESULT hr = g_pSwapChain->Present(0, 0); // Present without vsync
-		g_SwapChainOccluded = (hr == DXGI_STATUS_OCCLUDED);
-
-		UINT64 fenceValue = g_fenceLastSignaledValue + 1;
-		g_pd3dCommandQueue->Signal(g_fence, fenceValue);
-		g_fenceLastSignaledValue = fenceValue;
-		frameCtx->FenceValue = fenceValue;
-
-	}
-
-	WaitForLastSubmittedFrame();
-
-	// Cleanup
-	ImGui_ImplDX12_Shutdown();
-	ImGui_ImplWin32_Shutdown();
-	ImGui::DestroyContext();
-
-	CleanupDeviceD3D();
-	::DestroyWindow(hwnd);
-	::UnregisterClassW(wc.lpszClassName, wc.hInstance);
-	return 0;
-}
-
-namespace
-{
-
-	bool CreateDeviceD3D(HWND hWnd)
-	{
-		// Setup swap chain
-		DXGI_SWAP_CHAIN_DESC1 sd;
-		{
-			ZeroMemory(&sd, sizeof(sd));
-			sd.BufferCount = APP_NUM_BACK_BUFFERS;
-			sd.Width = 0;
-			sd.Height = 0;
-			sd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			sd.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
-			sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-			sd.SampleDesc.Count = 1;
-			sd.SampleDesc.Quality = 0;
-			sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-			sd.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
-			sd.Scaling = DXGI_SCALING_STRETCH;
-			sd.Stereo = FALSE;
-		}
-
-		// [DEBUG] Enable debug interface
-#ifdef DX12_ENABLE_DEBUG_LAYER
-		ID3D12Debug* pdx12Debug = nullptr;
-		if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&pdx12Debug))))
-			pdx12Debug->EnableDebugLayer();
-#endif
-
-		// Create device
-		D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
-		if (D3D12CreateDevice(nullptr, featureLevel, IID_PPV_ARGS(&g_pd3dDevice)) != S_OK)
-			return false;
-
-		// [DEBUG] Setup debug interface to break on any warnings/errors
-#ifdef DX12_ENABLE_DEBUG_LAYER
-		if (pdx12Debug != nullptr)
-		{
-			ID3D12InfoQueue* pInfoQueue = nullptr;
-			g_pd3dDevice->QueryInterface(IID_PPV_ARGS(&pInfoQueue));
-			pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_ERROR, true);
-			pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_CORRUPTION, true);
-			pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_WARNING, true);
-			pInfoQueue->Release();
-			pdx12Debug->Release();
-		}
-#endif
-
-		{
-			D3D12_DESCRIPTOR_HEAP_DESC desc = {};
-			desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-			desc.NumDescriptors = APP_NUM_BACK_BUFFERS;
-			desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-			desc.NodeMask = 1;
-			if (g_pd3dDevice->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&g_pd3dRtvDescHeap)) != S_OK)
-				return false;
-
-			SIZE_T rtvDescriptorSize = g_pd3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-			D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = g_pd3dRtvDescHeap->GetCPUDescriptorHandleForHeapStart();
-			for (UINT i = 0; i < APP_NUM_BACK_BUFFERS; i++)
-			{
-				g_mainRenderTargetDescriptor[i] = rtvHandle;
-				rtvHandle.ptr += rtvDescriptorSize;
-			}
-		}
-
-		{
-			D3D12_DESCRIPTOR_HEAP_DESC desc = {};
-			desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-			desc.NumDescriptors = APP_SRV_HEAP_SIZE;
-			desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-			if (g_pd3dDevice->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&g_pd3dSrvDescHeap)) != S_OK)
-				return false;
-			g_pd3dSrvDescHeapAlloc.Create(g_pd3dDevice, g_pd3dSrvDescHeap);
-		}
-
-		{
-			D3D12_COMMAND_QUEUE_DESC desc = {};
-			desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-			desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-			desc.NodeMask = 1;
-			if (g_pd3dDevice->CreateCommandQueue(&desc, IID_PPV_ARGS(&g_pd3dCommandQueue)) != S_OK)
-				return false;
-		}
-
-		for (UINT i = 0; i < APP_NUM_FRAMES_IN_FLIGHT; i++)
-			if (g_pd3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&g_frameContext[i].CommandAllocator)) != S_OK)
-				return false;
-
-		if (g_pd3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, g_frameContext[0].CommandAllocator, nullptr, IID_PPV_ARGS(&g_pd3dCommandList)) != S_OK ||
-			g_pd3dCommandList->Close() != S_OK)
-			return false;
-
-		if (g_pd3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_fence)) != S_OK)
-			return false;
-
-		g_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-		if (g_fenceEvent == nullptr)
-			return false;
-
-		{
-			IDXGIFactory4* dxgiFactory = nullptr;
-			IDXGISwapChain1* swapChain1 = nullptr;
-			if (CreateDXGIFactory1(IID_PPV_ARGS(&dxgiFactory)) != S_OK)
-				return false;
-			if (dxgiFactory->CreateSwapChainForHwnd(g_pd3dCommandQueue, hWnd, &sd, nullptr, nullptr, &swapChain1) != S_OK)
-				return false;
-			if (swapChain1->QueryInterface(IID_PPV_ARGS(&g_pSwapChain)) != S_OK)
-				return false;
-			swapChain1->Release();
-			dxgiFactory->Release();
-			g_pSwapChain->SetMaximumFrameLatency(APP_NUM_BACK_BUFFERS);
-			g_hSwapChainWaitableObject = g_pSwapChain->GetFrameLatencyWaitableObject();
-		}
-
-		CreateRenderTarget();
-		return true;
-	}
-
-	void CleanupDeviceD3D()
-	{
-		CleanupRenderTarget();
-		if (g_pSwapChain) { g_pSwapChain->SetFullscreenState(false, nullptr); g_pSwapChain->Release(); g_pSwapChain = nullptr; }
-		if (g_hSwapChainWaitableObject != nullptr) { CloseHandle(g_hSwapChainWaitableObject); }
-		for (UINT i = 0; i < APP_NUM_FRAMES_IN_FLIGHT; i++)
-			if (g_frameContext[i].CommandAllocator) { g_frameContext[i].CommandAllocator->Release(); g_frameContext[i].CommandAllocator = nullptr; }
-		if (g_pd3dCommandQueue) { g_pd3dCommandQueue->Release(); g_pd3dCommandQueue = nullptr; }
-		if (g_pd3dCommandList) { g_pd3dCommandList->Release(); g_pd3dCommandList = nullptr; }
-		if (g_pd3dRtvDescHeap) { g_pd3dRtvDescHeap->Release(); g_pd3dRtvDescHeap = nullptr; }
-		if (g_pd3dSrvDescHeap) { g_pd3dSrvDescHeap->Release(); g_pd3dSrvDescHeap = nullptr; }
-		if (g_fence) { g_fence->Release(); g_fence = nullptr; }
-		if (g_fenceEvent) { CloseHandle(g_fenceEvent); g_fenceEvent = nullptr; }
-		if (g_pd3dDevice) { g_pd3dDevice->Release(); g_pd3dDevice = nullptr; }
-
-#ifdef DX12_ENABLE_DEBUG_LAYER
-		IDXGIDebug1* pDebug = nullptr;
-		if (SUCCEEDED(DXGIGetDebugInterface1(0, IID_PPV_ARGS(&pDebug))))
-		{
-			pDebug->ReportLiveObjects(DXGI_DEBUG_ALL, DXGI_DEBUG_RLO_SUMMARY);
-			pDebug->Release();
-		}
-#endif
-	}
-
-	void CreateRenderTarget()
-	{
-		for (UINT i = 0; i < APP_NUM_BACK_BUFFERS; i++)
-		{
-			ID3D12Resource* pBackBuffer = nullptr;
-			g_pSwapChain->GetBuffer(i, IID_PPV_ARGS(&pBackBuffer));
-			g_pd3dDevice->CreateRenderTargetView(pBackBuffer, nullptr, g_mainRenderTargetDescriptor[i]);
-			g_mainRenderTargetResource[i] = pBackBuffer;
-		}
-	}
-
-	void CleanupRenderTarget()
-	{
-		WaitForLastSubmittedFrame();
-
-		for (UINT i = 0; i < APP_NUM_BACK_BUFFERS; i++)
-			if (g_mainRenderTargetResource[i]) { g_mainRenderTargetResource[i]->Release(); g_mainRenderTargetResource[i] = nullptr; }
-	}
-
-	void WaitForLastSubmittedFrame()
-	{
-		FrameContext* frameCtx = &g_frameContext[g_frameIndex % APP_NUM_FRAMES_IN_FLIGHT];
-
-		UINT64 fenceValue = frameCtx->FenceValue;
-		if (fenceValue == 0)
-			return; // No fence was signaled
-
-		frameCtx->FenceValue = 0;
-		if (g_fence->GetCompletedValue() >= fenceValue)
-			return;
-
-		g_fence->SetEventOnCompletion(fenceValue, g_fenceEvent);
-		WaitForSingleObject(g_fenceEvent, INFINITE);
-	}
-
-	FrameContext* WaitForNextFrameResources()
-	{
-		UINT nextFrameIndex = g_frameIndex + 1;
-		g_frameIndex = nextFrameIndex;
-
-		HANDLE waitableObjects[] = { g_hSwapChainWaitableObject, nullptr };
-		DWORD numWaitableObjects = 1;
-
-		FrameContext* frameCtx = &g_frameContext[nextFrameIndex % APP_NUM_FRAMES_IN_FLIGHT];
-		UINT64 fenceValue = frameCtx->FenceValue;
-		if (fenceValue != 0) // means no fence was signaled
-		{
-			frameCtx->FenceValue = 0;
-			g_fence->SetEventOnCompletion(fenceValue, g_fenceEvent);
-			waitableObjects[1] = g_fenceEvent;
-			numWaitableObjects = 2;
-		}
-
-		WaitForMultipleObjects(numWaitableObjects, waitableObjects, TRUE, INFINITE);
-
-		return frameCtx;
-	}
+#include <windows.h>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+
+#include "imgui.h"
+#include "misc/cpp/imgui_stdlib.h"
+#include "imgui_impl_win32.h"
+#include "imgui_impl_dx12.h"
+
+#include <d3d12.h>
+#include <dxgi1_4.h>
+
+#include "tsvdata.hpp"
+#include "rowcache.hpp"
+#include "selection.hpp"
+#include "config.hpp"
+
+#ifdef _DEBUG
+#define DX12_ENABLE_DEBUG_LAYER
+#endif
+
+
+#ifdef DX12_ENABLE_DEBUG_LAYER
+#include <dxgidebug.h>
+#pragma comment(lib, "dxguid.lib")
+#endif
+
+namespace
+{
+	// Config for example app
+	static const int APP_NUM_FRAMES_IN_FLIGHT = 2;
+	static const int APP_NUM_BACK_BUFFERS = 2;
+	static const int APP_SRV_HEAP_SIZE = 64;
+
+	struct FrameContext
+	{
+		ID3D12CommandAllocator* CommandAllocator;
+		UINT64                      FenceValue;
+	};
+
+	// Simple free list based allocator
+	struct ExampleDescriptorHeapAllocator
+	{
+		ID3D12DescriptorHeap* Heap = nullptr;
+		D3D12_DESCRIPTOR_HEAP_TYPE  HeapType = D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES;
+		D3D12_CPU_DESCRIPTOR_HANDLE HeapStartCpu;
+		D3D12_GPU_DESCRIPTOR_HANDLE HeapStartGpu;
+		UINT                        HeapHandleIncrement;
+		ImVector<int>               FreeIndices;
+
+		void Create(ID3D12Device* device, ID3D12DescriptorHeap* heap)
+		{
+			IM_ASSERT(Heap == nullptr && FreeIndices.empty());
+			Heap = heap;
+			D3D12_DESCRIPTOR_HEAP_DESC desc = heap->GetDesc();
+			HeapType = desc.Type;
+			HeapStartCpu = Heap->GetCPUDescriptorHandleForHeapStart();
+			HeapStartGpu = Heap->GetGPUDescriptorHandleForHeapStart();
+			HeapHandleIncrement = device->GetDescriptorHandleIncrementSize(HeapType);
+			FreeIndices.reserve((int)desc.NumDescriptors);
+			for (int n = desc.NumDescriptors; n > 0; n--)
+				FreeIndices.push_back(n - 1);
+		}
+		void Destroy()
+		{
+			Heap = nullptr;
+			FreeIndices.clear();
+		}
+		void Alloc(D3D12_CPU_DESCRIPTOR_HANDLE* out_cpu_desc_handle, D3D12_GPU_DESCRIPTOR_HANDLE* out_gpu_desc_handle)
+		{
+			IM_ASSERT(FreeIndices.Size > 0);
+			int idx = FreeIndices.back();
+			FreeIndices.pop_back();
+			out_cpu_desc_handle->ptr = HeapStartCpu.ptr + (idx * HeapHandleIncrement);
+			out_gpu_desc_handle->ptr = HeapStartGpu.ptr + (idx * HeapHandleIncrement);
+		}
+		void Free(D3D12_CPU_DESCRIPTOR_HANDLE out_cpu_desc_handle, D3D12_GPU_DESCRIPTOR_HANDLE out_gpu_desc_handle)
+		{
+			int cpu_idx = (int)((out_cpu_desc_handle.ptr - HeapStartCpu.ptr) / HeapHandleIncrement);
+			int gpu_idx = (int)((out_gpu_desc_handle.ptr - HeapStartGpu.ptr) / HeapHandleIncrement);
+			IM_ASSERT(cpu_idx == gpu_idx);
+			FreeIndices.push_back(cpu_idx);
+		}
+	};
+
+	// Data
+	FrameContext                 g_frameContext[APP_NUM_FRAMES_IN_FLIGHT] = {};
+	UINT                         g_frameIndex = 0;
+
+	ID3D12Device*					g_pd3dDevice = nullptr;
+	ID3D12DescriptorHeap*			g_pd3dRtvDescHeap = nullptr;
+	ID3D12DescriptorHeap*			g_pd3dSrvDescHeap = nullptr;
+	ExampleDescriptorHeapAllocator	g_pd3dSrvDescHeapAlloc;
+	ID3D12CommandQueue*				g_pd3dCommandQueue = nullptr;
+	ID3D12GraphicsCommandList*		g_pd3dCommandList = nullptr;
+	ID3D12Fence*					g_fence = nullptr;
+	HANDLE							g_fenceEvent = nullptr;
+	UINT64							g_fenceLastSignaledValue = 0;
+	IDXGISwapChain3*				g_pSwapChain = nullptr;
+	bool							g_SwapChainOccluded = false;
+	HANDLE							g_hSwapChainWaitableObject = nullptr;
+	ID3D12Resource*					g_mainRenderTargetResource[APP_NUM_BACK_BUFFERS] = {};
+	D3D12_CPU_DESCRIPTOR_HANDLE		g_mainRenderTargetDescriptor[APP_NUM_BACK_BUFFERS] = {};
+
+	// Forward declarations of helper functions
+	bool CreateDeviceD3D(HWND hWnd);
+	void CleanupDeviceD3D();
+	void CreateRenderTarget();
+	void CleanupRenderTarget();
+	void WaitForLastSubmittedFrame();
+	FrameContext* WaitForNextFrameResources();
+	LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+}
+
+
+extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+namespace
+{
+	LRESULT WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	{
+		if (ImGui_ImplWin32_WndProcHandler(hWnd, msg, wParam, lParam))
+			return true;
+
+		switch (msg)
+		{
+		case WM_SIZE:
+			if (g_pd3dDevice != nullptr && wParam != SIZE_MINIMIZED)
+			{
+				WaitForLastSubmittedFrame();
+				CleanupRenderTarget();
+				HRESULT result = g_pSwapChain->ResizeBuffers(0, (UINT)LOWORD(lParam), (UINT)HIWORD(lParam), DXGI_FORMAT_UNKNOWN, DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT);
+				assert(SUCCEEDED(result) && "Failed to resize swapchain.");
+				CreateRenderTarget();
+			}
+			return 0;
+		case WM_SYSCOMMAND:
+			if ((wParam & 0xfff0) == SC_KEYMENU) // Disable ALT application menu
+				return 0;
+			break;
+		case WM_DESTROY:
+			::PostQuitMessage(0);
+			return 0;
+		}
+
+		return ::DefWindowProcW(hWnd, msg, wParam, lParam);
+	}
+
+
+	std::atomic_bool s_exiting(false);
+
+	// operators in the order of data::FilterOp
+	const char* s_filterOps[] = { "=", "a..b", "a*", "*a*", "empty" };
+	// in the order of data::AggregateOp
+	const char* s_aggregateOps[] = { "count", "sum", "min", "max", "avg" };
+
+	struct FilterInput
+	{
+		int op = 0;
+		std::string text;
+	};
+
+	struct View
+	{
+		bool visible = false;
+		data::SortSpec sorts;
+
+		/*
+						ImGuiSelectableFlags selectable_flags = (contents_type == CT_SelectableSpanRow) ? ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap : ImGuiSelectableFlags_None;
+						if (ImGui::Selectable(label, item_is_selected, selectable_flags, ImVec2(0, row_min_height)))
+		*/
+		// by row id, kept across sort and filter changes
+		data::RowSelection selection;
+		// position clicked last in the order and filter it was clicked in, shift click selects from it
+		int anchor = -1;
+		data::SortSpec anchorSort;
+		data::RowFilter anchorFilter;
+		// a shift click range read on the data set's worker, its row ids join the selection when they come
+		std::shared_ptr<data::ResultQueue> selecting = std::make_shared<data::ResultQueue>();
+		uint64_t selectTicket = 0;
+
+		// copy of the selection or export of it or the whole view, started from inside the table where the shown columns are known
+		enum class Output { None, Clipboard, File };
+		Output startOutput = Output::None;
+		std::shared_ptr<data::ExportJob> output;
+		// what a copy collects, set to the clipboard once done
+		std::shared_ptr<std::string> copied;
+		std::string outputPath;
+		data::ExportOptions outputOptions;
+		std::string outputResult;
+
+		// search box text, the view only shows rows containing it
+		std::string search;
+		// per column, edits apply from the next frame
+		std::vector<FilterInput> filters;
+		// position of the match picked with next/previous, -1 for none
+		int match = -1;
+		bool scrollToMatch = false;
+
+		// columns read for the rows, the visible ones and neighbours to scroll to
+		data::Projection projection;
+		// first data column shown when the table is too wide to lay out whole
+		int firstColumn = 1;
+		float columnWheel = 0.0f;
+
+		// column whose profile popup is open, the job is held so a cancelled one isn't started again
+		int profileColumn = 0;
+		bool openProfile = false;
+		std::shared_ptr<data::ProfileJob> profile;
+
+		// group by panel, a window of its own while open. The spec is edited, ran is what the job was started with.
+		bool groupsOpen = false;
+		data::GroupBySpec groupSpec;
+		data::GroupBySpec groupsRan;
+		std::shared_ptr<data::GroupByJob> groups;
+		int groupOp = 0;
+		int groupColumn = 1;
+
+		std::unique_ptr<data::RowCache> rows;
+	};
+
+	// Two of a data set's tables joined on a key column each, shown a page of pairs at a time
+	struct JoinView
+	{
+		std::string name;
+		data::DbTableMetaData left;
+		data::DbTableMetaData right;
+		bool visible = true;
+		std::shared_ptr<data::JoinJob> job;
+
+		// rows of the pairs from first on as read last, row id and shown columns of each side
+		using Row = std::vector<data::DbDataSet::ValType>;
+		uint64_t first = 0;
+		std::vector<std::pair<Row, Row>> rows;
+
+		// the page being read on the data set's worker, each side's rows by ticket. Shown once both are in.
+		std::shared_ptr<data::ResultQueue> reading = std::make_shared<data::ResultQueue>();
+		uint64_t readingFirst = 0;
+		std::vector<data::JoinPair> readingPairs;
+		uint64_t tickets[2] = { 0, 0 };
+		std::unique_ptr<data::PageResult> results[2];
+	};
+
+	struct ViewState
+	{
+		std::unordered_map<std::string, View> views;
+		// joins picked in the data set's window, a table and key column for each side
+		std::list<JoinView> joins;
+		int joinTables[2] = { 0, 0 };
+		int joinColumns[2] = { 1, 1 };
+		// numbers the joins' windows, names repeat when the same join is picked again
+		int joinsMade = 0;
+		// statement cache hits as of the previous frame
+		uint64_t statementHits = 0;
+	};
+
+	std::unordered_map<std::string, ViewState> m_state;
+
+	ViewState& getViewState(data::DbDataSet& db)
+	{
+		auto [path, pattern] = db.GetPath();
+		static std::string key;
+		key.clear();
+		key.reserve(path.size() + pattern.size());
+		key.append(path).append(pattern);
+		return m_state[key];
+	}
+
+	constexpr int DefaultWidth = 1280;
+	constexpr int DefaultHeight = 800;
+
+	// the most columns ImGui takes in a table (IMGUI_TABLE_MAX_COLUMNS), wider tables show a window of them
+	constexpr int maxTableColumns = 512;
+
+	// history entry -> data set, entries resolving to the same location and content share one
+	std::unordered_map<std::string, std::shared_ptr<data::DbDataSet>> s_data;
+
+	std::unordered_map<std::string, bool> s_opened;
+
+	config::Config s_config;
+
+	void logMsg(const std::string& msg)
+	{
+		std::cout << msg;
+	}
+
+	std::string aggregateLabel(const data::DbTableMetaData& table, const data::Aggregate& aggregate)
+	{
+		std::string ret = s_aggregateOps[int(aggregate.op)];
+		if (aggregate.op != data::AggregateOp::Count)
+			ret.append("(").append(table.columns[aggregate.column]).append(")");
+		return ret;
+	}
+
+	// Numbers of a column as far as the profile got, min to max with quantiles and a histogram
+	void DrawColumnProfile(const data::DbTableMetaData& table, int column, data::ProfileJob& job)
+	{
+		static const float TEXT_BASE_WIDTH = ImGui::CalcTextSize("A").x;
+
+		const auto result = job.Result();
+		ImGui::TextUnformatted(table.columns[column].c_str());
+		if (!job.Done())
+		{
+			char progress[64];
+			const auto scanned = result ? result->scanned : 0;
+			sprintf_s(progress, std::extent<decltype(progress)>(), "%llu of %llu rows", (unsigned long long)scanned, (unsigned long long)table.count);
+			ImGui::SameLine();
+			ImGui::ProgressBar(table.count ? float(double(scanned) / double(table.count)) : 0.0f, ImVec2(TEXT_BASE_WIDTH * 30, 0), progress);
+			ImGui::SameLine();
+			if (ImGui::SmallButton("cancel"))
+				job.Cancel();
+		}
+		else if (job.Failed() || job.Cancelled())
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled(job.Failed() ? "failed, partial result" : "cancelled, partial result");
+		}
+		if (!result)
+			return;
+
+		ImGui::Text("%llu numbers, %llu other, %llu empty", (unsigned long long)result->numbers, (unsigned long long)result->texts, (unsigned long long)result->empties);
+		if (result->numbers == 0)
+			return;
+
+		ImGui::Text("min %.15g  mean %.15g  max %.15g", result->min, result->mean, result->max);
+		for (size_t i = 0; i < result->quantiles.size(); ++i)
+		{
+			if (i)
+				ImGui::SameLine();
+			ImGui::Text("p%g %.6g", data::profileQuantiles[i] * 100, result->quantiles[i]);
+		}
+
+		// the range grows by doubling, bins outside the values are left out
+		auto first = std::find_if(result->bins.begin(), result->bins.end(), [](uint64_t count) { return count != 0; });
+		auto last = std::find_if(result->bins.rbegin(), result->bins.rend(), [](uint64_t count) { return count != 0; }).base();
+		std::vector<float> bins(first, last);
+		const double low = result->histogramLow + result->binWidth * double(first - result->bins.begin());
+		ImGui::PlotHistogram("##histogram", bins.data(), int(bins.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(TEXT_BASE_WIDTH * 70, TEXT_BASE_WIDTH * 16));
+		ImGui::TextDisabled("%.6g to %.6g in %d bins of %.6g", low, low + result->binWidth * double(bins.size()), int(bins.size()), result->binWidth);
+	}
+
+	// Picks a view's group by and shows its groups as they come in, a group clicked filters the view to it
+	void DrawGroupsWindow(const std::shared_ptr<data::DbDataSet>& pDb, const data::DbTableMetaData& table, View& view, const data::RowFilter& filter)
+	{
+		const std::string name = "group by - " + table.table_name;
+		ImGui::SetNextWindowSize(ImVec2(640, 480), ImGuiCond_Once);
+		if (!ImGui::Begin(name.c_str(), &view.groupsOpen, 0))
+		{
+			ImGui::End();
+			return;
+		}
+
+		static const float TEXT_BASE_WIDTH = ImGui::CalcTextSize("A").x;
+		auto& spec = view.groupSpec;
+
+		auto columnCombo = [&](const char* id, const char* preview, auto&& fnPicked)
+			{
+				if (ImGui::BeginCombo(id, preview))
+				{
+					for (int column = 1; column < int(table.columns.size()); ++column)
+					{
+						ImGui::PushID(column);
+						if (ImGui::Selectable(table.columns[column].c_str()))
+							fnPicked(column);
+						ImGui::PopID();
+					}
+					ImGui::EndCombo();
+				}
+			};
+
+		ImGui::TextUnformatted("by");
+		for (size_t i = 0; i < spec.keys.size(); ++i)
+		{
+			ImGui::SameLine();
+			ImGui::PushID(int(i));
+			if (ImGui::SmallButton((table.columns[spec.keys[i]] + " x").c_str()))
+				spec.keys.erase(spec.keys.begin() + i--);
+			ImGui::PopID();
+		}
+		ImGui::SameLine();
+		ImGui::SetNextItemWidth(TEXT_BASE_WIDTH * 20);
+		columnCombo("##key", "add column", [&](int column)
+			{
+				if (std::find(spec.keys.begin(), spec.keys.end(), column) == spec.keys.end())
+					spec.keys.push_back(column);
+			});
+
+		ImGui::TextUnformatted("show");
+		for (size_t i = 0; i < spec.aggregates.size(); ++i)
+		{
+			ImGui::SameLine();
+			ImGui::PushID(int(i));
+			if (ImGui::SmallButton((aggregateLabel(table, spec.aggregates[i]) + " x").c_str()))
+				spec.aggregates.erase(spec.aggregates.begin() + i--);
+			ImGui::PopID();
+		}
+		ImGui::SameLine();
+		ImGui::SetNextItemWidth(TEXT_BASE_WIDTH * 8);
+		ImGui::Combo("##op", &view.groupOp, s_aggregateOps, IM_ARRAYSIZE(s_aggregateOps));
+		view.groupColumn = std::clamp(view.groupColumn, 1, std::max(1, int(table.columns.size()) - 1));
+		if (data::AggregateOp(view.groupOp) != data::AggregateOp::Count && view.groupColumn < int(table.columns.size()))
+		{
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(TEXT_BASE_WIDTH * 20);
+			columnCombo("##of", table.columns[view.groupColumn].c_str(), [&](int column) { view.groupColumn = column; });
+		}
+		ImGui::SameLine();
+		if (ImGui::SmallButton("add"))
+		{
+			const data::Aggregate aggregate{ data::AggregateOp(view.groupOp), data::AggregateOp(view.groupOp) == data::AggregateOp::Count ? 0 : view.groupColumn };
+			if (std::find(spec.aggregates.begin(), spec.aggregates.end(), aggregate) == spec.aggregates.end())
+				spec.aggregates.push_back(aggregate);
+		}
+
+		// the rows the view shows, a job for the same ones is handed back by the data set
+		if (ImGui::Button("run"))
+		{
+			// the job running for the same spec carries on, one for another spec stops
+			spec.filter = filter;
+			if (view.groups && !view.groups->Done() && !(spec == view.groupsRan))
+				view.groups->Cancel();
+			view.groupsRan = spec;
+			view.groups = pDb->GroupBy(table, spec, logMsg);
+		}
+
+		if (!view.groups)
+		{
+			ImGui::End();
+			return;
+		}
+
+		auto& job = *view.groups;
+		const auto result = job.Result();
+		if (!job.Done())
+		{
+			char progress[64];
+			const auto scanned = result ? result->scanned : 0;
+			sprintf_s(progress, std::extent<decltype(progress)>(), "%llu of %llu rows", (unsigned long long)scanned, (unsigned long long)table.count);
+			ImGui::SameLine();
+			ImGui::ProgressBar(table.count ? float(double(scanned) / double(table.count)) : 0.0f, ImVec2(TEXT_BASE_WIDTH * 30, 0), progress);
+			ImGui::SameLine();
+			if (ImGui::SmallButton("cancel"))
+				job.Cancel();
+		}
+		else if (job.Failed())
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled("failed, partial result");
+		}
+		else if (job.Cancelled())
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled("cancelled, partial result");
+		}
+		if (result)
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled(result->truncated ? "%d groups, too many to show all" : "%d groups", int(result->groups.size()));
+		}
+		if (view.groupsRan.filter != filter)
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled("(for an earlier filter)");
+		}
+
+		const auto& ran = view.groupsRan;
+		const int columns = int(ran.keys.size() + 1 + ran.aggregates.size());
+		const ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_ScrollY | ImGuiTableFlags_ScrollX;
+		if (result && ImGui::BeginTable("groups", columns, flags))
+		{
+			for (auto key : ran.keys)
+			{
+				ImGui::TableSetupColumn(table.columns[key].c_str());
+			}
+			ImGui::TableSetupColumn("rows");
+			for (const auto& aggregate : ran.aggregates)
+			{
+				ImGui::TableSetupColumn(aggregateLabel(table, aggregate).c_str());
+			}
+			ImGui::TableSetupScrollFreeze(0, 1);
+			ImGui::TableHeadersRow();
+
+			ImGuiListClipper clipper;
+			clipper.Begin(int(result->groups.size()));
+			while (clipper.Step())
+			{
+				for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
+				{
+					const auto& group = result->groups[size_t(row)];
+					ImGui::PushID(row);
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+
+					char text[64];
+					sprintf_s(text, std::extent<decltype(text)>(), "%lld", (long long)group.rows);
+
+					// drills down, the group's key values become the view's filters on those columns
+					if (ImGui::Selectable(ran.keys.empty() ? text : group.keys[0].empty() ? "(empty)" : group.keys[0].c_str(), false, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap) && !ran.keys.empty())
+					{
+						view.filters.resize(table.columns.size());
+						for (size_t k = 0; k < ran.keys.size(); ++k)
+						{
+							auto& input = view.filters[ran.keys[k]];
+							input.op = int(group.keys[k].empty() ? data::FilterOp::Empty : data::FilterOp::Equals);
+							input.text = group.keys[k];
+						}
+						view.match = -1;
+					}
+
+					for (size_t k = 1; k < ran.keys.size(); ++k)
+					{
+						ImGui::TableNextColumn();
+						ImGui::TextUnformatted(group.keys[k].empty() ? "(empty)" : group.keys[k].c_str());
+					}
+					if (!ran.keys.empty())
+					{
+						ImGui::TableNextColumn();
+						ImGui::TextUnformatted(text);
+					}
+					for (auto value : group.values)
+					{
+						ImGui::TableNextColumn();
+						if (!std::isnan(value))
+							ImGui::Text("%.15g", value);
+					}
+					ImGui::PopID();
+				}
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::End();
+	}
+
+	void DrawTableView(const std::shared_ptr<data::DbDataSet>& pDb, const data::DbTableMetaData& table, bool* opened)
+	{
+		ImGui::SetNextWindowSize(ImVec2(1024, 768), ImGuiCond_Once);
+
+		if (!ImGui::Begin(table.table_name.c_str(), opened, 0))
+		{
+			ImGui::End();
+			return;
+		}
+
+		ImGuiTableFlags flags =
+			ImGuiTableFlags_Resizable | ImGuiTableFlags_Reorderable | ImGuiTableFlags_Hideable | ImGuiTableFlags_Sortable
+			| ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_NoBordersInBody
+			| ImGuiTableFlags_ScrollY | ImGuiTableFlags_ScrollX;
+
+		std::string table_view_name = table.table_name;
+		table_view_name.append("_data");
+
+		static const float TEXT_BASE_WIDTH = ImGui::CalcTextSize("A").x;
+		static const float TEXT_BASE_HEIGHT = ImGui::GetTextLineHeightWithSpacing();
+
+		int initHeight = table.count > 30 ? 30 : int(table.count);
+		int initWidth = table.columns.size() > 50 ? 50 : int(table.columns.size());
+
+		ViewState& viewState = getViewState(*pDb);
+
+		View& view = viewState.views[table_view_name];
+		if (!view.rows)
+			view.rows = std::make_unique<data::RowCache>();
+
+		for (const auto& result : view.selecting->TakeAll())
+		{
+			if (result->ticket != view.selectTicket)
+				continue;
+			for (auto id : result->ids)
+				view.selection.Add(id);
+			view.selectTicket = 0;
+		}
+
+		ImGui::SetNextItemWidth(TEXT_BASE_WIDTH * 40);
+		if (ImGui::InputTextWithHint("##search", "search", &view.search))
+		{
+			view.match = -1;
+			table.store->RequestSearch();
+		}
+		ImGui::SameLine();
+		if (ImGui::SmallButton("group by..."))
+			view.groupsOpen = true;
+
+		data::RowFilter filter;
+		filter.search = view.search;
+		for (int column = 1; column < int(view.filters.size()); ++column)
+		{
+			const auto& input = view.filters[column];
+			const std::string& text = input.text;
+			if (text.empty() && input.op != int(data::FilterOp::Empty))
+				continue;
+
+			data::ColumnFilter cf{ column, data::FilterOp(input.op), text };
+			if (cf.op == data::FilterOp::Range)
+			{
+				auto dots = text.find("..");
+				cf.value = text.substr(0, dots);
+				cf.upper = dots == std::string::npos ? std::string() : text.substr(dots + 2);
+			}
+			filter.columns.push_back(std::move(cf));
+		}
+
+		// exact once counted, sized from a sample or the rows read so far until then
+		const auto count = pDb->GetCount(table, filter, logMsg);
+		const int end = view.rows->End();
+		const int known = count.exact ? int(count.rows) : end >= 0 ? end : view.rows->Extent();
+		int shown = known;
+		if (!count.exact && end < 0)
+			shown = std::min(int(table.count), count.rows >= 0 ? std::max(int(count.rows), known) : known + 64);
+
+		if (!filter.empty())
+		{
+			ImGui::SameLine();
+			if (ImGui::ArrowButton("##previous", ImGuiDir_Up) && known > 0)
+			{
+				view.match = view.match <= 0 ? known - 1 : std::min(view.match, known) - 1;
+				view.scrollToMatch = true;
+			}
+			ImGui::SameLine();
+			if (ImGui::ArrowButton("##next", ImGuiDir_Down) && known > 0)
+			{
+				view.match = (view.match + 1) % known;
+				view.scrollToMatch = true;
+			}
+
+			ImGui::SameLine();
+			if (!count.exact && end < 0)
+			{
+				if (count.rows >= 0)
+					ImGui::TextDisabled("counting, about %lld", (long long)count.rows);
+				else
+					ImGui::TextDisabled("counting, %d so far", known);
+			}
+			else if (view.match >= 0 && view.match < known)
+				ImGui::Text("%d of %d matches", view.match + 1, known);
+			else
+				ImGui::Text("%d matches", known);
+
+			const auto indexes = table.store->GetIndexes();
+			if (std::any_of(indexes.begin(), indexes.end(), [](const data::IndexInfo& index) { return index.search && !index.ready && !index.failed; }))
+			{
+				ImGui::SameLine();
+				ImGui::TextDisabled("(indexing, scanning meanwhile)");
+			}
+		}
+
+		if (view.selectTicket)
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled("selecting...");
+		}
+		else if (!view.selection.Empty())
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled("%llu selected", (unsigned long long)view.selection.Count());
+			if (!view.output)
+			{
+				ImGui::SameLine();
+				if (ImGui::SmallButton("copy"))
+					view.startOutput = View::Output::Clipboard;
+			}
+		}
+		// without a selection all rows of the view are exported, so not while one is still being read
+		if (!view.output && !view.selectTicket)
+		{
+			ImGui::SameLine();
+			if (ImGui::SmallButton("export..."))
+				ImGui::OpenPopup("export");
+		}
+
+		if (ImGui::BeginPopup("export"))
+		{
+			if (view.outputPath.size() < 255)
+				view.outputPath.resize(255);
+			ImGui::SetNextItemWidth(TEXT_BASE_WIDTH * 60);
+			ImGui::InputTextWithHint("##path", view.selection.Empty() ? "file to write the rows shown to" : "file to write the selected rows to", view.outputPath.data(), int(view.outputPath.size()));
+			ImGui::SameLine();
+			if (ImGui::RadioButton("TSV", view.outputOptions.format == data::ExportFormat::Tsv))
+				view.outputOptions.format = data::ExportFormat::Tsv;
+			ImGui::SameLine();
+			if (ImGui::RadioButton("CSV", view.outputOptions.format == data::ExportFormat::Csv))
+				view.outputOptions.format = data::ExportFormat::Csv;
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Arrow", view.outputOptions.format == data::ExportFormat::Arrow))
+				view.outputOptions.format = data::ExportFormat::Arrow;
+			// an Arrow file is mapped by whoever reads it, it isn't compressed
+			if (data::CanCompressExports() && view.outputOptions.format != data::ExportFormat::Arrow)
+			{
+				ImGui::SameLine();
+				ImGui::Checkbox("zstd", &view.outputOptions.compress);
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("write") && view.outputPath[0])
+			{
+				view.startOutput = View::Output::File;
+				ImGui::CloseCurrentPopup();
+			}
+			ImGui::EndPopup();
+		}
+
+		if (view.output)
+		{
+			const auto& job = *view.output;
+			if (job.Done())
+			{
+				if (job.Failed())
+					view.outputResult = "failed writing the rows";
+				else if (job.Cancelled())
+					view.outputResult = "cancelled";
+				else if (view.copied)
+					view.outputResult = "copied " + std::to_string(job.Rows()) + " rows";
+				else
+					view.outputResult = "exported " + std::to_string(job.Rows()) + " rows to " + view.outputPath.c_str();
+
+				if (view.copied && !job.Failed() && !job.Cancelled())
+					ImGui::SetClipboardText(view.copied->c_str());
+				view.output.reset();
+				view.copied.reset();
+			}
+			else
+			{
+				char progress[64];
+				sprintf_s(progress, std::extent<decltype(progress)>(), "%llu of %llu rows", (unsigned long long)job.Rows(), (unsigned long long)job.Total());
+				ImGui::SameLine();
+				ImGui::ProgressBar(job.Total() ? float(double(job.Rows()) / double(job.Total())) : 0.0f, ImVec2(TEXT_BASE_WIDTH * 30, 0), progress);
+				ImGui::SameLine();
+				if (ImGui::SmallButton("cancel"))
+					view.output->Cancel();
+			}
+		}
+		if (!view.output && !view.outputResult.empty())
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled("%s", view.outputResult.c_str());
+		}
+
+		// past maxTableColumns only the columns fitting the view are set up, column 0 stays and the rest is a
+		// window moved with the slider or the horizontal wheel. Sorting is kept here, ImGui's is per set up column.
+		const int dataColumns = int(table.columns.size()) - 1;
+		const bool windowed = int(table.columns.size()) > maxTableColumns;
+		const float columnWidth = TEXT_BASE_WIDTH * 16;
+		int slots = int(table.columns.size());
+		if (windowed)
+		{
+			const int window = std::clamp(int(ImGui::GetContentRegionAvail().x / columnWidth), 1, dataColumns);
+			const int lastFirst = dataColumns - window + 1;
+
+			auto& io = ImGui::GetIO();
+			if (ImGui::IsWindowHovered(ImGuiHoveredFlags_ChildWindows))
+			{
+				view.columnWheel -= io.MouseWheelH != 0.0f ? io.MouseWheelH : io.KeyShift ? io.MouseWheel : 0.0f;
+				const int steps = int(view.columnWheel);
+				view.firstColumn += steps;
+				view.columnWheel -= float(steps);
+			}
+
+			ImGui::SetNextItemWidth(TEXT_BASE_WIDTH * 40);
+			ImGui::SliderInt("##columns", &view.firstColumn, 1, lastFirst, "columns from %d");
+			view.firstColumn = std::clamp(view.firstColumn, 1, lastFirst);
+			ImGui::SameLine();
+			ImGui::TextDisabled("to %d of %d", view.firstColumn + window - 1, dataColumns);
+
+			slots = 1 + window;
+			flags &= ~(ImGuiTableFlags_Resizable | ImGuiTableFlags_Reorderable | ImGuiTableFlags_Hideable | ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollX);
+		}
+		auto tableColumn = [&](int slot) { return windowed && slot > 0 ? view.firstColumn + slot - 1 : slot; };
+
+		if (ImGui::BeginTable(table_view_name.c_str(), slots, flags, ImVec2(0, 0/*initHeight * (TEXT_BASE_HEIGHT + 5)*/), 0/*initWidth * TEXT_BASE_WIDTH * 10*/))
+		{
+			if (windowed)
+			{
+				for (int slot = 0; slot < slots; ++slot)
+				{
+					ImGui::TableSetupColumn(nullptr, ImGuiTableColumnFlags_WidthFixed, slot == 0 ? 0.0f : columnWidth);
+				}
+			}
+			else
+			{
+				int i = 0;
+				for (const auto& col : table.columns)
+				{
+					ImGui::TableSetupColumn(col.c_str(), (i++ == 0 ? ImGuiTableColumnFlags_NoReorder | ImGuiTableColumnFlags_NoHide : ImGuiTableColumnFlags_None));
+				}
+			}
+
+			ImGui::TableSetupScrollFreeze(1, 2); // Make row always visible
+
+			if (windowed)
+			{
+				// click sorts by the column alone or flips it, shift click adds it as a further key
+				ImGui::TableNextRow(ImGuiTableRowFlags_Headers);
+				for (int slot = 0; slot < slots; ++slot)
+				{
+					if (!ImGui::TableSetColumnIndex(slot))
+						continue;
+
+					const int column = tableColumn(slot);
+					auto key = std::find_if(view.sorts.begin(), view.sorts.end(), [&](const data::SortKey& key) { return key.column == column; });
+
+					std::string label = table.columns[column];
+					if (key != view.sorts.end())
+						label.append(key->descending ? " v" : " ^");
+
+					ImGui::PushID(slot);
+					ImGui::TableHeader(label.c_str());
+					if (ImGui::IsItemClicked())
+					{
+						if (key != view.sorts.end() && (ImGui::GetIO().KeyShift || view.sorts.size() == 1))
+							key->descending = !key->descending;
+						else if (ImGui::GetIO().KeyShift)
+							view.sorts.push_back({ column, false });
+						else
+							view.sorts = { { column, false } };
+
+					}
+					ImGui::PopID();
+				}
+			}
+			else
+			{
+				ImGui::TableHeadersRow();
+			}
+
+			// filter inputs under the headers
+			view.filters.resize(table.columns.size());
+			ImGui::TableNextRow();
+			for (int slot = 1; slot < slots; ++slot)
+			{
+				if (!ImGui::TableSetColumnIndex(slot))
+					continue;
+
+				const int column = tableColumn(slot);
+				auto& input = view.filters[column];
+
+				ImGui::PushID(column);
+				if (ImGui::SmallButton("~"))
+				{
+					view.profileColumn = column;
+					view.openProfile = true;
+				}
+				ImGui::SetItemTooltip("distribution of the column's numbers");
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(ImGui::GetFontSize() * 3.5f);
+				ImGui::Combo("##op", &input.op, s_filterOps, IM_ARRAYSIZE(s_filterOps));
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(-FLT_MIN);
+				ImGui::InputTextWithHint("##value", input.op == int(data::FilterOp::Range) ? "from..to" : "", &input.text);
+				ImGui::PopID();
+			}
+
+			// profiles the rows the view shows, the data set keeps it for the next time
+			if (view.openProfile)
+			{
+				view.profile = pDb->Profile(table, view.profileColumn, filter, logMsg);
+				view.openProfile = false;
+				ImGui::OpenPopup("profile");
+			}
+			if (ImGui::BeginPopup("profile"))
+			{
+				if (view.profile && view.profileColumn < int(table.columns.size()))
+					DrawColumnProfile(table, view.profileColumn, *view.profile);
+				ImGui::EndPopup();
+			}
+
+			ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs();
+
+			if (sort_specs && sort_specs->SpecsDirty)
+			{
+				data::SortSpec& sort = view.sorts;
+
+				sort.clear();
+
+				for (int i = 0; i < sort_specs->SpecsCount; ++i)
+				{
+					const auto spec = sort_specs->Specs[i];
+					assert(spec.ColumnIndex < table.columns.size());
+
+					sort.push_back({ int(spec.ColumnIndex), spec.SortDirection == ImGuiSortDirection_Descending });
+				}
+
+				sort_specs->SpecsDirty = false;
+			}
+
+			// hidden and scrolled out columns aren't read. Neighbours of the visible ones are read along, so the
+			// rows are only read again once scrolling passes them or a column is hidden.
+			auto enabled = [&](int column) { return windowed || (ImGui::TableGetColumnFlags(column) & ImGuiTableColumnFlags_IsEnabled); };
+			{
+				int lo = int(table.columns.size()), hi = 0;
+				bool covered = true;
+				for (int slot = 1; slot < slots; ++slot)
+				{
+					if (!(ImGui::TableGetColumnFlags(slot) & ImGuiTableColumnFlags_IsVisible))
+						continue;
+					const int column = tableColumn(slot);
+					lo = std::min(lo, column);
+					hi = std::max(hi, column);
+					covered = covered && std::binary_search(view.projection.begin(), view.projection.end(), column);
+				}
+				const bool hidden = std::any_of(view.projection.begin(), view.projection.end(), [&](int column) { return !enabled(column); });
+
+				if (!covered || hidden)
+				{
+					const int span = hi - lo + 1;
+					view.projection.clear();
+					for (int column = std::max(1, lo - span); column <= hi + span && column < int(table.columns.size()); ++column)
+					{
+						if (enabled(column))
+							view.projection.push_back(column);
+					}
+				}
+			}
+
+			// copies and exports take the order, filter and columns shown, hidden columns stay out
+			if (view.startOutput != View::Output::None && !view.output)
+			{
+				data::Projection shownColumns;
+				for (int column = 1; !windowed && column < int(table.columns.size()); ++column)
+				{
+					if (enabled(column))
+						shownColumns.push_back(column);
+				}
+				if (!windowed && shownColumns.empty())
+					shownColumns.push_back(0);
+
+				data::DbDataSet::fnWrite fnOut;
+				if (view.startOutput == View::Output::Clipboard)
+				{
+					view.copied = std::make_shared<std::string>();
+					fnOut = [copied = view.copied](std::string_view piece) { copied->append(piece); return true; };
+				}
+				else if (auto file = std::make_shared<std::ofstream>(view.outputPath.c_str(), std::ios::binary); *file)
+				{
+					fnOut = [file](std::string_view piece) { return bool(file->write(piece.data(), std::streamsize(piece.size()))); };
+				}
+
+				if (fnOut)
+				{
+					view.outputResult.clear();
+					// copies are of the selection as TSV, files take the popup's format
+					const bool copy = view.startOutput == View::Output::Clipboard;
+					const auto rows = copy || !view.selection.Empty() ? &view.selection : nullptr;
+					view.output = pDb->Export(table, view.sorts, filter, shownColumns, rows, copy ? data::ExportOptions{} : view.outputOptions, std::move(fnOut), logMsg);
+				}
+				else
+				{
+					view.outputResult = std::string("couldn't open ") + view.outputPath.c_str();
+				}
+				view.startOutput = View::Output::None;
+			}
+
+			// where each visible column's cell is in the rows read
+			std::vector<std::pair<int, size_t>> cells;
+			for (int slot = 1; slot < slots; ++slot)
+			{
+				if (!(ImGui::TableGetColumnFlags(slot) & ImGuiTableColumnFlags_IsVisible))
+					continue;
+				auto found = std::lower_bound(view.projection.begin(), view.projection.end(), tableColumn(slot));
+				if (found != view.projection.end() && *found == tableColumn(slot))
+					cells.emplace_back(slot, size_t(found - view.projection.begin()) + 1);
+			}
+
+			const float rowHeight = ImGui::GetTextLineHeight() + ImGui::GetStyle().CellPadding.y * 2;
+			if (view.scrollToMatch)
+			{
+				ImGui::SetScrollY(std::max(0.0f, view.match * rowHeight - ImGui::GetWindowHeight() / 2));
+				view.scrollToMatch = false;
+			}
+
+			ImGuiListClipper clipper;
+			clipper.Begin(shown, rowHeight);
+			while (clipper.Step())
+			{
+				auto start = clipper.DisplayStart;
+				auto end = clipper.DisplayEnd;
+
+				int position = start;
+				int drawn = view.rows->GetRows(pDb, table, view.sorts, filter, view.projection, start, end, [&](const std::vector<data::DbDataSet::ValType>& data)
+					{
+						int id = std::get<int>(data[0]);
+						const int rowAt = position++;
+						const bool is_match = rowAt == view.match;
+
+						auto& selection = view.selection;
+						const bool item_is_selected = selection.Contains(uint32_t(id));
+
+						ImGui::PushID(id);
+						ImGui::TableNextRow();
+						if (is_match)
+							ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg1, ImGui::GetColorU32(ImGuiCol_TextSelectedBg));
+
+						ImGuiSelectableFlags selectable_flags = ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap;
+
+
+						ImGui::TableNextColumn();
+						char label[32];
+						sprintf_s(label, std::extent<decltype(label)>(), "%d", id);
+						if (ImGui::Selectable(label, item_is_selected, selectable_flags))
+						{
+							// a range still being read would land on a selection since changed
+							if (view.selectTicket && (ImGui::GetIO().KeyShift || !ImGui::GetIO().KeyCtrl))
+							{
+								pDb->Cancel(view.selecting.get());
+								view.selectTicket = 0;
+							}
+
+							if (ImGui::GetIO().KeyShift)
+							{
+								// the rows between are resolved in the data set, whether they were drawn or not
+								const int from = view.anchor >= 0 && view.anchorSort == view.sorts && view.anchorFilter == filter ? view.anchor : 0;
+								if (!ImGui::GetIO().KeyCtrl)
+									selection.Clear();
+								view.selectTicket = pDb->SelectRange(view.selecting, table, view.sorts, filter, std::min(from, rowAt), std::max(from, rowAt) + 1, selection, logMsg);
+							}
+							else
+							{
+								if (!ImGui::GetIO().KeyCtrl)
+									selection.Clear();
+								if (ImGui::GetIO().KeyCtrl && item_is_selected)
+									selection.Remove(uint32_t(id));
+								else
+									selection.Add(uint32_t(id));
+
+								view.anchor = rowAt;
+								view.anchorSort = view.sorts;
+								view.anchorFilter = filter;
+							}
+						}
+
+						for (const auto& [slot, at] : cells)
+						{
+							if (at >= data.size() || !ImGui::TableSetColumnIndex(slot))
+								continue;
+
+							const auto& str = std::get<std::string>(data[at]);
+
+							ImGui::TextUnformatted(str.c_str());
+						}
+						ImGui::PopID();
+					}, logMsg);
+
+				// rows still being read keep their place
+				for (int row = start + drawn; row < end; ++row)
+				{
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextDisabled("...");
+				}
+			}
+
+			ImGui::EndTable();
+		}
+
+
+		ImGui::End();
+
+		if (view.groupsOpen)
+			DrawGroupsWindow(pDb, table, view, filter);
+	}
+
+	void DrawHistoryWindow()
+	{
+		if (!ImGui::Begin("History", 0, ImGuiWindowFlags_NoDocking))
+		{
+			ImGui::End();
+			return;
+		}
+
+		static std::string add;
+		if (add.size() < 255)
+			add.resize(255);
+
+		if (ImGui::InputText("path", add.data(), int(add.size()), ImGuiInputTextFlags_EnterReturnsTrue))
+		{
+			std::string add_config(add.begin(), add.begin() + strlen(add.c_str()));
+
+			s_config.HistoryAdd(add_config);
+			add[0] = '\0';
+			add.clear();
+		}
+
+		ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImGui::ColorConvertU32ToFloat4(0xFF0000FF));
+
+		std::vector<std::tuple<int, std::string>> erase;
+
+		s_config.HistoryGet([&](int id, const char* hData)
+			{
+				std::string history(hData);
+				ImGui::PushID(id);
+				if (ImGui::SmallButton("X"))
+				{
+					erase.emplace_back(id, history);
+					ImGui::PopID();
+					return;
+				}
+				ImGui::SameLine();
+				if (ImGui::SmallButton(hData))
+				{
+					if (s_data.count(history))
+					{
+						if (s_opened.count(history) && !s_opened[history])
+						{
+							s_opened[history] = true;
+						}
+						else
+						{
+							s_opened[history] = false;
+						}
+					}
+					else
+					{
+						try
+						{
+							s_data[history] = data::DbDataSet::Open(hData, ".txt", logMsg);
+							s_opened[history] = true;
+						}
+						catch (...)
+						{
+							erase.emplace_back(id, history);
+						}
+					}
+				}
+				ImGui::PopID();
+			});
+
+		for (const auto& [id, history] : erase)
+		{
+			s_data.erase(history);
+			s_opened.erase(history);
+			s_config.HistoryRem(id);
+		}
+
+		ImGui::PopStyleColor();
+		ImGui::End();
+	}
+
+	void DrawJoinView(const std::shared_ptr<data::DbDataSet>& pDb, JoinView& join)
+	{
+		ImGui::SetNextWindowSize(ImVec2(1024, 768), ImGuiCond_Once);
+		if (!ImGui::Begin(join.name.c_str(), &join.visible, 0))
+		{
+			ImGui::End();
+			return;
+		}
+
+		static const float TEXT_BASE_WIDTH = ImGui::CalcTextSize("A").x;
+
+		auto& job = *join.job;
+		const auto rows = job.Rows();
+		ImGui::Text("%llu rows", (unsigned long long)rows);
+		if (!job.Done())
+		{
+			char progress[64];
+			sprintf_s(progress, std::extent<decltype(progress)>(), "%llu of %llu rows read", (unsigned long long)job.Scanned(), (unsigned long long)job.Total());
+			ImGui::SameLine();
+			ImGui::ProgressBar(job.Total() ? float(double(job.Scanned()) / double(job.Total())) : 0.0f, ImVec2(TEXT_BASE_WIDTH * 30, 0), progress);
+			ImGui::SameLine();
+			if (ImGui::SmallButton("cancel"))
+				job.Cancel();
+		}
+		else if (job.Truncated() || job.Failed() || job.Cancelled())
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled(job.Truncated() ? "stopped, too many rows" : job.Failed() ? "failed, partial result" : "cancelled, partial result");
+		}
+
+		// both tables' columns side by side after their row ids, each cut to half of what ImGui lays out
+		const auto shownColumns = [](const data::DbTableMetaData& table)
+			{
+				data::Projection ret;
+				for (int column = 1; column < int(table.columns.size()) && column <= (maxTableColumns - 2) / 2; ++column)
+					ret.push_back(column);
+				return ret;
+			};
+		const auto leftColumns = shownColumns(join.left);
+		const auto rightColumns = shownColumns(join.right);
+
+		const ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_ScrollY | ImGuiTableFlags_ScrollX;
+		if (ImGui::BeginTable("join", int(2 + leftColumns.size() + rightColumns.size()), flags))
+		{
+			for (const auto& [table, columns] : { std::tie(join.left, leftColumns), std::tie(join.right, rightColumns) })
+			{
+				ImGui::TableSetupColumn((table.table_name + ".row_id").c_str());
+				for (auto column : columns)
+				{
+					ImGui::TableSetupColumn((table.table_name + "." + table.columns[column]).c_str());
+				}
+			}
+			ImGui::TableSetupScrollFreeze(0, 1);
+			ImGui::TableHeadersRow();
+
+			ImGuiListClipper clipper;
+			clipper.Begin(int(std::min<uint64_t>(rows, INT_MAX)));
+			while (clipper.Step())
+			{
+				const auto start = uint64_t(clipper.DisplayStart);
+				const auto end = uint64_t(clipper.DisplayEnd);
+
+				// pairs only ever get added, a page stays good until scrolled past. A page around the shown
+				// rows is read by row id from each side on the worker, the one shown stays until it's in.
+				const bool shown = start >= join.first && end <= join.first + join.rows.size();
+				const bool reading = (join.tickets[0] || join.tickets[1]) && start >= join.readingFirst && end <= join.readingFirst + join.readingPairs.size();
+				if (!shown && !reading)
+				{
+					const auto margin = std::max<uint64_t>(end - start, 64);
+					join.readingFirst = start - std::min(start, margin);
+					join.readingPairs.clear();
+					job.Pairs(join.readingFirst, end + margin, join.readingPairs);
+
+					std::vector<uint32_t> leftIds, rightIds;
+					for (const auto& pair : join.readingPairs)
+					{
+						leftIds.push_back(pair.left);
+						rightIds.push_back(pair.right);
+					}
+					pDb->Cancel(join.reading.get());
+					join.results[0].reset();
+					join.results[1].reset();
+					join.tickets[0] = pDb->SubmitRowIds(join.reading, join.left, leftColumns, std::move(leftIds), logMsg);
+					join.tickets[1] = pDb->SubmitRowIds(join.reading, join.right, rightColumns, std::move(rightIds), logMsg);
+				}
+
+				for (auto& result : join.reading->TakeAll())
+				{
+					for (int side = 0; side < 2; ++side)
+					{
+						if (join.tickets[side] && result->ticket == join.tickets[side])
+							join.results[side] = std::move(result);
+					}
+				}
+
+				// a pair whose row is missing on either side ends the page, so both sides stay on the same pair
+				if (join.results[0] && join.results[1])
+				{
+					auto& left = join.results[0]->rows;
+					auto& right = join.results[1]->rows;
+					join.first = join.readingFirst;
+					join.rows.clear();
+					for (size_t i = 0; i < join.readingPairs.size() && i < left.size() && i < right.size(); ++i)
+					{
+						if (uint32_t(std::get<int>(left[i][0])) != join.readingPairs[i].left || uint32_t(std::get<int>(right[i][0])) != join.readingPairs[i].right)
+							break;
+						join.rows.emplace_back(std::move(left[i]), std::move(right[i]));
+					}
+					join.tickets[0] = join.tickets[1] = 0;
+					join.results[0].reset();
+					join.results[1].reset();
+				}
+
+				for (auto row = start; row < end; ++row)
+				{
+					ImGui::TableNextRow();
+					if (row < join.first || row - join.first >= join.rows.size())
+					{
+						ImGui::TableNextColumn();
+						ImGui::TextDisabled("...");
+						continue;
+					}
+
+					const auto& pair = join.rows[row - join.first];
+					for (const auto* cells : { &pair.first, &pair.second })
+					{
+						ImGui::TableNextColumn();
+						ImGui::Text("%d", std::get<int>((*cells)[0]));
+						for (size_t i = 1; i < cells->size(); ++i)
+						{
+							ImGui::TableNextColumn();
+							ImGui::TextUnformatted(std::get<std::string>((*cells)[i]).c_str());
+						}
+					}
+				}
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::End();
+	}
+
+	void DrawMetaWindow(const std::shared_ptr<data::DbDataSet>& pDb, bool* opened)
+	{
+		auto& db = *pDb;
+
+		if (opened && !*opened)
+			return;
+
+		static std::string name;
+
+		name.clear();
+		name.append("DB - ");
+		name.append(std::get<0>(db.GetPath()));
+
+		if (!ImGui::Begin(name.c_str(), opened, ImGuiWindowFlags_NoDocking))
+		{
+			ImGui::End();
+			return;
+		}
+
+
+		ImGui::PushStyleColor(ImGuiCol_Button, ImGui::ColorConvertU32ToFloat4(0x000000FF));
+		ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImGui::ColorConvertU32ToFloat4(0xFF0000FF));
+		ImGui::TextUnformatted("Path:");
+		ImGui::SameLine();
+		ImGui::SmallButton(std::get<0>(db.GetPath()).c_str());
+		ImGui::PopStyleColor();
+		ImGui::PopStyleColor();
+		ImGui::Text("sqlite memory %.1f / %.1f MB", double(sqlite3_memory_used()) / (1024.0 * 1024.0), double(data::GetMemoryBudget()) / (1024.0 * 1024.0));
+
+		{
+			// hits since the last frame would each have cost an average prepare
+			const auto& stmts = db.GetStatementStats();
+			auto& state = getViewState(db);
+			double prepareUs = stmts.misses ? stmts.prepare_seconds * 1e6 / double(stmts.misses) : 0.0;
+			ImGui::Text("statements %llu hits / %llu misses, prepare %.1f us, saved %.1f us/frame",
+				(unsigned long long)stmts.hits, (unsigned long long)stmts.misses, prepareUs, double(stmts.hits - std::min(stmts.hits, state.statementHits)) * prepareUs);
+			state.statementHits = stmts.hits;
+		}
+		ImGui::Spacing();
+		ImGui::Spacing();
+
+		ImGuiTreeNodeFlags base_flags = ImGuiTreeNodeFlags_DrawLinesFull | ImGuiTreeNodeFlags_DefaultOpen;
+		if (ImGui::TreeNodeEx("Tables", base_flags))
+		{
+			ImGuiTreeNodeFlags child_flags = ImGuiTreeNodeFlags_DrawLinesFull;
+
+			const auto& meta = db.GetTableMetaData();
+
+			ViewState& viewState = getViewState(db);
+
+			for (const auto& tab : meta.tables)
+			{
+				static std::stringstream name;
+
+				name.str("");
+				name.clear();
+				name << tab.table_name << " (" << tab.count << ")";
+
+				if (ImGui::TreeNodeEx(name.str().c_str(), child_flags))
+				{
+					if (ImGui::Button("table"))
+					{
+						viewState.views[tab.table_name].visible = (!viewState.views.count(tab.table_name) || !viewState.views[tab.table_name].visible) ? true : false;
+					}
+
+					if (viewState.views[tab.table_name].visible)
+					{
+						DrawTableView(pDb, tab, &viewState.views[tab.table_name].visible);
+					}
+
+					// a closed view stops its reads and lets go of its rows
+					if (!viewState.views[tab.table_name].visible)
+					{
+						viewState.views[tab.table_name + "_data"].rows.reset();
+					}
+
+
+					ImGui::Text(tab.file_name.c_str());
+					ImGui::Text("encoding %s", codec::EncodingName(tab.encoding));
+					const auto location = tab.store->Location();
+					if (location.tier == data::StorageTier::Disk)
+						ImGui::Text("storage %s (%s)", data::StorageTierName(location.tier), location.file.string().c_str());
+					else
+						ImGui::Text("storage %s", data::StorageTierName(location.tier));
+
+					if (tab.dictionary_saved)
+					{
+						ImGui::Text("dictionary encoding saves %.1f MB", double(tab.dictionary_saved) / (1024.0 * 1024.0));
+					}
+
+					const auto indexes = tab.store->GetIndexes();
+					if (!indexes.empty())
+					{
+						name.str("");
+						name.clear();
+						name << "indexes (" << indexes.size() << ")";
+						if (ImGui::TreeNodeEx(name.str().c_str(), child_flags))
+						{
+							for (const auto& index : indexes)
+							{
+								if (index.ready)
+									ImGui::Text("%s %.1f MB, built in %.2fs", index.name.c_str(), double(index.bytes) / (1024.0 * 1024.0), index.build_seconds);
+								else
+									ImGui::Text("%s %s", index.name.c_str(), index.failed ? "failed" : "building...");
+							}
+							ImGui::TreePop();
+						}
+					}
+
+					const auto permutations = tab.store->GetPermutations();
+					if (permutations.count)
+					{
+						ImGui::Text("sort permutations %zu, %.1f MB", permutations.count, double(permutations.bytes) / (1024.0 * 1024.0));
+					}
+
+					name.str("");
+					name.clear();
+					name << "columns (" << tab.columns.size() << ")";
+					if (ImGui::TreeNodeEx(name.str().c_str(), child_flags))
+					{
+						const auto& dictionaries = tab.store->dictionaries;
+						for (size_t i = 0; i < tab.columns.size(); ++i)
+						{
+							if (i < dictionaries.size() && !dictionaries[i].empty())
+								ImGui::Text("%s (%d values)", tab.columns[i].c_str(), int(dictionaries[i].size()));
+							else
+								ImGui::Text(tab.columns[i].c_str());
+						}
+						ImGui::TreePop();
+					}
+					ImGui::TreePop();
+				}
+
+			}
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNodeEx("Joins", base_flags))
+		{
+			const auto& meta = db.GetTableMetaData();
+			ViewState& viewState = getViewState(db);
+
+			// a table and its key column for each side
+			for (int side = 0; side < 2 && !meta.tables.empty(); ++side)
+			{
+				auto& index = viewState.joinTables[side];
+				index = std::clamp(index, 0, int(meta.tables.size()) - 1);
+				const auto& table = meta.tables[index];
+				auto& column = viewState.joinColumns[side];
+				column = std::clamp(column, 1, std::max(1, int(table.columns.size()) - 1));
+
+				ImGui::PushID(side);
+				ImGui::TextUnformatted(side == 0 ? "left " : "right");
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(ImGui::GetFontSize() * 12);
+				if (ImGui::BeginCombo("##table", table.table_name.c_str()))
+				{
+					for (int i = 0; i < int(meta.tables.size()); ++i)
+					{
+						ImGui::PushID(i);
+						if (ImGui::Selectable(meta.tables[i].table_name.c_str(), i == index))
+							index = i;
+						ImGui::PopID();
+					}
+					ImGui::EndCombo();
+				}
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(ImGui::GetFontSize() * 12);
+				if (ImGui::BeginCombo("##column", column < int(table.columns.size()) ? table.columns[column].c_str() : ""))
+				{
+					for (int i = 1; i < int(table.columns.size()); ++i)
+					{
+						ImGui::PushID(i);
+						if (ImGui::Selectable(table.columns[i].c_str(), i == column))
+							column = i;
+						ImGui::PopID();
+					}
+					ImGui::EndCombo();
+				}
+				ImGui::PopID();
+			}
+
+			if (!meta.tables.empty() && ImGui::Button("join"))
+			{
+				const auto& left = meta.tables[viewState.joinTables[0]];
+				const auto& right = meta.tables[viewState.joinTables[1]];
+				const int leftColumn = viewState.joinColumns[0];
+				const int rightColumn = viewState.joinColumns[1];
+				if (leftColumn < int(left.columns.size()) && rightColumn < int(right.columns.size()))
+				{
+					auto& join = viewState.joins.emplace_back();
+					join.name = left.table_name + "." + left.columns[leftColumn] + " = " + right.table_name + "." + right.columns[rightColumn] + "##" + std::to_string(++viewState.joinsMade);
+					join.left = left;
+					join.right = right;
+					join.job = pDb->Join(left, leftColumn, right, rightColumn, logMsg);
+				}
+			}
+
+			for (auto it = viewState.joins.begin(); it != viewState.joins.end();)
+			{
+				auto& join = *it;
+				ImGui::PushID(&join);
+				ImGui::TextUnformatted(join.name.c_str(), join.name.c_str() + join.name.find("##"));
+				ImGui::SameLine();
+				ImGui::TextDisabled("(%llu)", (unsigned long long)join.job->Rows());
+				ImGui::SameLine();
+				if (ImGui::SmallButton("show"))
+					join.visible = !join.visible;
+				ImGui::SameLine();
+				const bool closed = ImGui::SmallButton("x");
+				ImGui::PopID();
+
+				if (join.visible && !closed)
+					DrawJoinView(pDb, join);
+				it = closed ? viewState.joins.erase(it) : std::next(it);
+			}
+
+			ImGui::TreePop();
+		}
+
+		ImGui::End();
+	}
+}
+
+void DrawDataWindows()
+{
+	std::unordered_set<data::DbDataSet*> drawn;
+
+	for (const auto& data : s_data)
+	{
+		auto& [key, pData] = data;
+		if (s_opened.count(key) && s_opened[key] && drawn.insert(pData.get()).second)
+		{
+			auto& flag = s_opened[key];
+			DrawMetaWindow(pData, &flag);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string configP("config.db");
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (_stricmp("-config",argv[i]) == 0)
+		{
+			if (i + 1 < argc)
+			{
+				configP = argv[i + 1];
+				i++;
+			}
+		}
+		else if (_stricmp("-membudget", argv[i]) == 0)
+		{
+			if (i + 1 < argc)
+			{
+				// megabytes, 0 keeps everything in memory
+				data::SetMemoryBudget(size_t(std::strtoull(argv[i + 1], nullptr, 10)) << 20);
+				i++;
+			}
+		}
+	}
+
+	std::filesystem::path cfg_path(configP);
+
+	if (!s_config.CreatePaths(cfg_path))
+	{
+		std::cout << "Failed to create config database path: " << cfg_path.parent_path() << "\n";
+		return 1;
+	}
+
+	s_config.Load(configP);
+
+	//s_data = std::make_unique<data::DbDataSet>();
+	//s_data->LoadFromPath(datapath.c_str(), ".txt", logMsg);
+
+	ImGui_ImplWin32_EnableDpiAwareness();
+	float main_scale = ImGui_ImplWin32_GetDpiScaleForMonitor(::MonitorFromPoint(POINT{ 0, 0 }, MONITOR_DEFAULTTOPRIMARY));
+
+	// Create application window
+	WNDCLASSEXW wc = { sizeof(wc), CS_CLASSDC, WndProc, 0L, 0L, GetModuleHandle(nullptr), nullptr, nullptr, nullptr, nullptr, L"Gui4Life", nullptr };
+	::RegisterClassExW(&wc);
+	HWND hwnd = ::CreateWindowW(wc.lpszClassName, L"Gui4Life", WS_OVERLAPPEDWINDOW, 100, 100, (int)(DefaultWidth * main_scale), (int)(DefaultHeight * main_scale), nullptr, nullptr, wc.hInstance, nullptr);
+
+	// Initialize Direct3D
+	if (!CreateDeviceD3D(hwnd))
+	{
+		CleanupDeviceD3D();
+		::UnregisterClassW(wc.lpszClassName, wc.hInstance);
+		return 1;
+	}
+
+	::ShowWindow(hwnd, SW_SHOWDEFAULT);
+	::UpdateWindow(hwnd);
+
+
+	// Setup Dear ImGui context
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO(); (void)io;
+	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
+	io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
+	io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;         // Enable Docking
+	io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;       // Enable Multi-Viewport / Platform Windows
+
+	ImGui::StyleColorsDark();
+
+	// Setup scaling
+	ImGuiStyle& style = ImGui::GetStyle();
+	style.ScaleAllSizes(main_scale);        // Bake a fixed style scale. (until we have a solution for dynamic style scaling, changing this requires resetting Style + calling this again)
+	style.FontScaleDpi = main_scale;        // Set initial font scale. (using io.ConfigDpiScaleFonts=true makes this unnecessary. We leave both here for documentation purpose)
+	io.ConfigDpiScaleFonts = true;          // [Experimental] Automatically overwrite style.FontScaleDpi in Begin() when Monitor DPI changes. This will scale fonts but _NOT_ scale sizes/padding for now.
+	io.ConfigDpiScaleViewports = true;      // [Experimental] Scale Dear ImGui and Platform Windows when Monitor DPI changes.
+
+	// When viewports are enabled we tweak WindowRounding/WindowBg so platform windows can look identical to regular ones.
+	if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+	{
+		style.WindowRounding = 0.0f;
+		style.Colors[ImGuiCol_WindowBg].w = 1.0f;
+	}
+
+	// Setup Platform/Renderer backends
+	ImGui_ImplWin32_Init(hwnd);
+
+	ImGui_ImplDX12_InitInfo init_info = {};
+	init_info.Device = g_pd3dDevice;
+	init_info.CommandQueue = g_pd3dCommandQueue;
+	init_info.NumFramesInFlight = APP_NUM_FRAMES_IN_FLIGHT;
+	init_info.RTVFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+	init_info.DSVFormat = DXGI_FORMAT_UNKNOWN;
+	// Allocating SRV descriptors (for textures) is up to the application, so we provide callbacks.
+	// (current version of the backend will only allocate one descriptor, future versions will need to allocate more)
+	init_info.SrvDescriptorHeap = g_pd3dSrvDescHeap;
+	init_info.SrvDescriptorAllocFn = [](ImGui_ImplDX12_InitInfo*, D3D12_CPU_DESCRIPTOR_HANDLE* out_cpu_handle, D3D12_GPU_DESCRIPTOR_HANDLE* out_gpu_handle) { return g_pd3dSrvDescHeapAlloc.Alloc(out_cpu_handle, out_gpu_handle); };
+	init_info.SrvDescriptorFreeFn = [](ImGui_ImplDX12_InitInfo*, D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle, D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle) { return g_pd3dSrvDescHeapAlloc.Free(cpu_handle, gpu_handle); };
+	ImGui_ImplDX12_Init(&init_info);
+
+	bool show_demo_window = false;
+	bool show_another_window = false;
+	ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
+
+	while (!s_exiting)
+	{
+		MSG msg;
+		while (::PeekMessage(&msg, nullptr, 0U, 0U, PM_REMOVE))
+		{
+			::TranslateMessage(&msg);
+			::DispatchMessage(&msg);
+			if (msg.message == WM_QUIT)
+				s_exiting = true;
+		}
+		if (s_exiting)
+			break;
+
+		// Handle window screen locked
+		if ((g_SwapChainOccluded && g_pSwapChain->Present(0, DXGI_PRESENT_TEST) == DXGI_STATUS_OCCLUDED) || ::IsIconic(hwnd))
+		{
+			::Sleep(10);
+			continue;
+		}
+		g_SwapChainOccluded = false;
+
+		// Start the Dear ImGui frame
+		ImGui_ImplDX12_NewFrame();
+		ImGui_ImplWin32_NewFrame();
+		ImGui::NewFrame();
+
+		if (show_demo_window)
+			ImGui::ShowDemoWindow(&show_demo_window);
+
+		DrawHistoryWindow();
+		DrawDataWindows();
+
+		ImGui::Render();
+
+		FrameContext* frameCtx = WaitForNextFrameResources();
+		UINT backBufferIdx = g_pSwapChain->GetCurrentBackBufferIndex();
+		frameCtx->CommandAllocator->Reset();
+
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		barrier.Transition.pResource = g_mainRenderTargetResource[backBufferIdx];
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+		g_pd3dCommandList->Reset(frameCtx->CommandAllocator, nullptr);
+		g_pd3dCommandList->ResourceBarrier(1, &barrier);
+
+		// Render Dear ImGui graphics
+		const float clear_color_with_alpha[4] = { clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w };
+		g_pd3dCommandList->ClearRenderTargetView(g_mainRenderTargetDescriptor[backBufferIdx], clear_color_with_alpha, 0, nullptr);
+		g_pd3dCommandList->OMSetRenderTargets(1, &g_mainRenderTargetDescriptor[backBufferIdx], FALSE, nullptr);
+		g_pd3dCommandList->SetDescriptorHeaps(1, &g_pd3dSrvDescHeap);
+		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), g_pd3dCommandList);
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
+		g_pd3dCommandList->ResourceBarrier(1, &barrier);
+		g_pd3dCommandList->Close();
+
+		g_pd3dCommandQueue->ExecuteCommandLists(1, (ID3D12CommandList* const*)&g_pd3dCommandList);
+
+		// Update and Render additional Platform Windows
+		if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+		{
+			ImGui::UpdatePlatformWindows();
+			ImGui::RenderPlatformWindowsDefault();
+		}
+
+		// Present
+		HRESULT hr = g_pSwapChain->Present(1, 0);   // Present with vsync
+		//HRESULT hr = g_pSwapChain->Present(0, 0); // Present without vsync
+		g_SwapChainOccluded = (hr == DXGI_STATUS_OCCLUDED);
+
+		UINT64 fenceValue = g_fenceLastSignaledValue + 1;
+		g_pd3dCommandQueue->Signal(g_fence, fenceValue);
+		g_fenceLastSignaledValue = fenceValue;
+		frameCtx->FenceValue = fenceValue;
+
+	}
+
+	WaitForLastSubmittedFrame();
+
+	// Cleanup
+	ImGui_ImplDX12_Shutdown();
+	ImGui_ImplWin32_Shutdown();
+	ImGui::DestroyContext();
+
+	CleanupDeviceD3D();
+	::DestroyWindow(hwnd);
+	::UnregisterClassW(wc.lpszClassName, wc.hInstance);
+	return 0;
+}
+
+namespace
+{
+
+	bool CreateDeviceD3D(HWND hWnd)
+	{
+		// Setup swap chain
+		DXGI_SWAP_CHAIN_DESC1 sd;
+		{
+			ZeroMemory(&sd, sizeof(sd));
+			sd.BufferCount = APP_NUM_BACK_BUFFERS;
+			sd.Width = 0;
+			sd.Height = 0;
+			sd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			sd.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+			sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+			sd.SampleDesc.Count = 1;
+			sd.SampleDesc.Quality = 0;
+			sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+			sd.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
+			sd.Scaling = DXGI_SCALING_STRETCH;
+			sd.Stereo = FALSE;
+		}
+
+		// [DEBUG] Enable debug interface
+#ifdef DX12_ENABLE_DEBUG_LAYER
+		ID3D12Debug* pdx12Debug = nullptr;
+		if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&pdx12Debug))))
+			pdx12Debug->EnableDebugLayer();
+#endif
+
+		// Create device
+		D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
+		if (D3D12CreateDevice(nullptr, featureLevel, IID_PPV_ARGS(&g_pd3dDevice)) != S_OK)
+			return false;
+
+		// [DEBUG] Setup debug interface to break on any warnings/errors
+#ifdef DX12_ENABLE_DEBUG_LAYER
+		if (pdx12Debug != nullptr)
+		{
+			ID3D12InfoQueue* pInfoQueue = nullptr;
+			g_pd3dDevice->QueryInterface(IID_PPV_ARGS(&pInfoQueue));
+			pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_ERROR, true);
+			pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_CORRUPTION, true);
+			pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_WARNING, true);
+			pInfoQueue->Release();
+			pdx12Debug->Release();
+		}
+#endif
+
+		{
+			D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+			desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+			desc.NumDescriptors = APP_NUM_BACK_BUFFERS;
+			desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+			desc.NodeMask = 1;
+			if (g_pd3dDevice->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&g_pd3dRtvDescHeap)) != S_OK)
+				return false;
+
+			SIZE_T rtvDescriptorSize = g_pd3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+			D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = g_pd3dRtvDescHeap->GetCPUDescriptorHandleForHeapStart();
+			for (UINT i = 0; i < APP_NUM_BACK_BUFFERS; i++)
+			{
+				g_mainRenderTargetDescriptor[i] = rtvHandle;
+				rtvHandle.ptr += rtvDescriptorSize;
+			}
+		}
+
+		{
+			D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+			desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+			desc.NumDescriptors = APP_SRV_HEAP_SIZE;
+			desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+			if (g_pd3dDevice->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&g_pd3dSrvDescHeap)) != S_OK)
+				return false;
+			g_pd3dSrvDescHeapAlloc.Create(g_pd3dDevice, g_pd3dSrvDescHeap);
+		}
+
+		{
+			D3D12_COMMAND_QUEUE_DESC desc = {};
+			desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+			desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+			desc.NodeMask = 1;
+			if (g_pd3dDevice->CreateCommandQueue(&desc, IID_PPV_ARGS(&g_pd3dCommandQueue)) != S_OK)
+				return false;
+		}
+
+		for (UINT i = 0; i < APP_NUM_FRAMES_IN_FLIGHT; i++)
+			if (g_pd3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&g_frameContext[i].CommandAllocator)) != S_OK)
+				return false;
+
+		if (g_pd3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, g_frameContext[0].CommandAllocator, nullptr, IID_PPV_ARGS(&g_pd3dCommandList)) != S_OK ||
+			g_pd3dCommandList->Close() != S_OK)
+			return false;
+
+		if (g_pd3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_fence)) != S_OK)
+			return false;
+
+		g_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (g_fenceEvent == nullptr)
+			return false;
+
+		{
+			IDXGIFactory4* dxgiFactory = nullptr;
+			IDXGISwapChain1* swapChain1 = nullptr;
+			if (CreateDXGIFactory1(IID_PPV_ARGS(&dxgiFactory)) != S_OK)
+				return false;
+			if (dxgiFactory->CreateSwapChainForHwnd(g_pd3dCommandQueue, hWnd, &sd, nullptr, nullptr, &swapChain1) != S_OK)
+				return false;
+			if (swapChain1->QueryInterface(IID_PPV_ARGS(&g_pSwapChain)) != S_OK)
+				return false;
+			swapChain1->Release();
+			dxgiFactory->Release();
+			g_pSwapChain->SetMaximumFrameLatency(APP_NUM_BACK_BUFFERS);
+			g_hSwapChainWaitableObject = g_pSwapChain->GetFrameLatencyWaitableObject();
+		}
+
+		CreateRenderTarget();
+		return true;
+	}
+
+	void CleanupDeviceD3D()
+	{
+		CleanupRenderTarget();
+		if (g_pSwapChain) { g_pSwapChain->SetFullscreenState(false, nullptr); g_pSwapChain->Release(); g_pSwapChain = nullptr; }
+		if (g_hSwapChainWaitableObject != nullptr) { CloseHandle(g_hSwapChainWaitableObject); }
+		for (UINT i = 0; i < APP_NUM_FRAMES_IN_FLIGHT; i++)
+			if (g_frameContext[i].CommandAllocator) { g_frameContext[i].CommandAllocator->Release(); g_frameContext[i].CommandAllocator = nullptr; }
+		if (g_pd3dCommandQueue) { g_pd3dCommandQueue->Release(); g_pd3dCommandQueue = nullptr; }
+		if (g_pd3dCommandList) { g_pd3dCommandList->Release(); g_pd3dCommandList = nullptr; }
+		if (g_pd3dRtvDescHeap) { g_pd3dRtvDescHeap->Release(); g_pd3dRtvDescHeap = nullptr; }
+		if (g_pd3dSrvDescHeap) { g_pd3dSrvDescHeap->Release(); g_pd3dSrvDescHeap = nullptr; }
+		if (g_fence) { g_fence->Release(); g_fence = nullptr; }
+		if (g_fenceEvent) { CloseHandle(g_fenceEvent); g_fenceEvent = nullptr; }
+		if (g_pd3dDevice) { g_pd3dDevice->Release(); g_pd3dDevice = nullptr; }
+
+#ifdef DX12_ENABLE_DEBUG_LAYER
+		IDXGIDebug1* pDebug = nullptr;
+		if (SUCCEEDED(DXGIGetDebugInterface1(0, IID_PPV_ARGS(&pDebug))))
+		{
+			pDebug->ReportLiveObjects(DXGI_DEBUG_ALL, DXGI_DEBUG_RLO_SUMMARY);
+			pDebug->Release();
+		}
+#endif
+	}
+
+	void CreateRenderTarget()
+	{
+		for (UINT i = 0; i < APP_NUM_BACK_BUFFERS; i++)
+		{
+			ID3D12Resource* pBackBuffer = nullptr;
+			g_pSwapChain->GetBuffer(i, IID_PPV_ARGS(&pBackBuffer));
+			g_pd3dDevice->CreateRenderTargetView(pBackBuffer, nullptr, g_mainRenderTargetDescriptor[i]);
+			g_mainRenderTargetResource[i] = pBackBuffer;
+		}
+	}
+
+	void CleanupRenderTarget()
+	{
+		WaitForLastSubmittedFrame();
+
+		for (UINT i = 0; i < APP_NUM_BACK_BUFFERS; i++)
+			if (g_mainRenderTargetResource[i]) { g_mainRenderTargetResource[i]->Release(); g_mainRenderTargetResource[i] = nullptr; }
+	}
+
+	void WaitForLastSubmittedFrame()
+	{
+		FrameContext* frameCtx = &g_frameContext[g_frameIndex % APP_NUM_FRAMES_IN_FLIGHT];
+
+		UINT64 fenceValue = frameCtx->FenceValue;
+		if (fenceValue == 0)
+			return; // No fence was signaled
+
+		frameCtx->FenceValue = 0;
+		if (g_fence->GetCompletedValue() >= fenceValue)
+			return;
+
+		g_fence->SetEventOnCompletion(fenceValue, g_fenceEvent);
+		WaitForSingleObject(g_fenceEvent, INFINITE);
+	}
+
+	FrameContext* WaitForNextFrameResources()
+	{
+		UINT nextFrameIndex = g_frameIndex + 1;
+		g_frameIndex = nextFrameIndex;
+
+		HANDLE waitableObjects[] = { g_hSwapChainWaitableObject, nullptr };
+		DWORD numWaitableObjects = 1;
+
+		FrameContext* frameCtx = &g_frameContext[nextFrameIndex % APP_NUM_FRAMES_IN_FLIGHT];
+		UINT64 fenceValue = frameCtx->FenceValue;
+		if (fenceValue != 0) // means no fence was signaled
+		{
+			frameCtx->FenceValue = 0;
+			g_fence->SetEventOnCompletion(fenceValue, g_fenceEvent);
+			waitableObjects[1] = g_fenceEvent;
+			numWaitableObjects = 2;
+		}
+
+		WaitForMultipleObjects(numWaitableObjects, waitableObjects, TRUE, INFINITE);
+
+		return frameCtx;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "rowcache.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	// pages are the visible row count, at least this many rows
+	constexpr int minPage = 64;
+	// read around the visible rows on a miss
+	constexpr int marginPages = 1;
+	// kept ready in the scroll direction, refilled once half of it is used up
+	constexpr int prefetchPages = 4;
+	constexpr size_t maxRows = 16384;
+	// a failed read, often a busy store, waits this long before it is asked for again
+	constexpr auto retryDelay = std::chrono::milliseconds(250);
+}
+
+namespace data
+{
+	RowCache::RowCache() : m_queue(std::make_shared<ResultQueue>())
+	{
+	}
+
+	RowCache::~RowCache()
+	{
+		cancel(true);
+	}
+
+	void RowCache::cancel(bool running)
+	{
+		if (auto db = m_db.lock())
+			db->Cancel(m_queue.get(), running);
+		m_pending.clear();
+	}
+
+	void RowCache::reset(const std::shared_ptr<DbDataSet>& db, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection)
+	{
+		cancel(true);
+
+		// the end of the filtered rows doesn't depend on the columns read
+		if (m_db.lock() != db || m_store.lock() != table.store || m_sort != sort || m_filter != filter)
+			m_end = -1;
+		m_retry = {};
+
+		m_db = db;
+		m_store = table.store;
+		m_sort = sort;
+		m_filter = filter;
+		m_projection = projection;
+		m_first = 0;
+		m_rows.clear();
+	}
+
+	void RowCache::take()
+	{
+		for (auto& result : m_queue->TakeAll())
+		{
+			auto found = m_pending.find(result->ticket);
+			if (found == m_pending.end())
+				continue;
+
+			// A clean short read found the end of the filtered rows. A failed one keeps what it read, the rest is
+			// missing again and asked for after a pause.
+			if (result->failed)
+				m_retry = std::chrono::steady_clock::now() + retryDelay;
+			else if (int(result->rows.size()) < found->second.second - found->second.first)
+				m_end = result->offset + int(result->rows.size());
+
+			m_pending.erase(found);
+			m_stats.prefetched += result->rows.size();
+			merge(result->offset, std::move(result->rows));
+		}
+	}
+
+	void RowCache::merge(int first, std::vector<Row>&& rows)
+	{
+		if (rows.empty())
+			return;
+
+		const int last = first + int(rows.size());
+		const int windowEnd = m_first + int(m_rows.size());
+
+		if (m_rows.empty() || last < m_first || first > windowEnd)
+		{
+			m_rows.clear();
+			m_first = first;
+			std::move(rows.begin(), rows.end(), std::back_inserter(m_rows));
+		}
+		else
+		{
+			for (int i = std::max(first, windowEnd); i < last; ++i)
+				m_rows.push_back(std::move(rows[i - first]));
+			for (int i = std::min(last, m_first) - 1; i >= first; --i)
+				m_rows.push_front(std::move(rows[i - first]));
+			m_first = std::min(first, m_first);
+		}
+
+		// drop what lies behind the scroll direction
+		while (m_rows.size() > maxRows)
+		{
+			if (m_direction > 0)
+			{
+				m_rows.pop_front();
+				m_first++;
+			}
+			else
+			{
+				m_rows.pop_back();
+			}
+		}
+	}
+
+	void RowCache::request(const std::shared_ptr<DbDataSet>& db, const DbTableMetaData& table, int from, int to, const fnLogger& logger)
+	{
+		auto ticket = db->Submit(m_queue, table, m_sort, m_filter, m_projection, from, to - from, logger);
+		m_pending[ticket] = { from, to };
+	}
+
+	void RowCache::prefetch(const std::shared_ptr<DbDataSet>& db, const DbTableMetaData& table, int start, int end, const fnLogger& logger)
+	{
+		// one read ahead at a time
+		if (!m_pending.empty() || std::chrono::steady_clock::now() < m_retry)
+			return;
+
+		const int count = m_end >= 0 ? m_end : int(table.count);
+		const int ahead = std::max(end - start, minPage) * prefetchPages;
+		const int windowEnd = m_first + int(m_rows.size());
+
+		if (m_direction > 0)
+		{
+			if (windowEnd < count && windowEnd - end < ahead / 2)
+				request(db, table, windowEnd, std::min(count, end + ahead), logger);
+		}
+		else
+		{
+			if (m_first > 0 && start - m_first < ahead / 2)
+				request(db, table, std::max(0, start - ahead), m_first, logger);
+		}
+	}
+
+	int RowCache::GetRows(const std::shared_ptr<DbDataSet>& db, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, int start, int end, const DbDataSet::fnRow& fnOnRow, const fnLogger& logger)
+	{
+		end = std::min(end, int(table.count));
+		if (start >= end)
+			return 0;
+
+		if (m_db.lock() != db || m_store.lock() != table.store || m_sort != sort || m_filter != filter || m_projection != projection)
+			reset(db, table, sort, filter, projection);
+
+		take();
+		if (m_end >= 0)
+			end = std::min(end, m_end);
+		if (start >= end)
+			return 0;
+
+		if (start != m_lastStart)
+		{
+			m_direction = start > m_lastStart ? 1 : -1;
+			m_lastStart = start;
+		}
+
+		const bool held = !m_rows.empty() && start >= m_first && end <= m_first + int(m_rows.size());
+		if (held)
+		{
+			m_stats.hits++;
+		}
+		else if (std::chrono::steady_clock::now() >= m_retry && std::none_of(m_pending.begin(), m_pending.end(), [&](const auto& pending) { return pending.second.first <= start && end <= pending.second.second; }))
+		{
+			m_stats.misses++;
+
+			// what's queued is for rows scrolled past. The running read is left to finish, the positions
+			// it finds on the way are kept by the data set, only its rows are ignored.
+			cancel(false);
+
+			const int page = std::max(end - start, minPage) * marginPages;
+			request(db, table, std::max(0, start - page), std::min(int(table.count), end + page), logger);
+		}
+
+		int delivered = 0;
+		if (start >= m_first)
+		{
+			const int last = std::min(end, m_first + int(m_rows.size()));
+			for (int i = start; i < last; ++i, ++delivered)
+			{
+				fnOnRow(m_rows[size_t(i - m_first)]);
+			}
+		}
+
+		if (held)
+			prefetch(db, table, start, end, logger);
+
+		return delivered;
+	}
+
+	void RowCache::Clear()
+	{
+		cancel(true);
+		m_first = 0;
+		m_rows.clear();
+	}
+}
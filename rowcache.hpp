@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "tsvdata.hpp"
+
+namespace data
+{
+	// Decoded rows around what a view shows, so frames that didn't scroll don't touch sqlite.
+	// Rows are read by the data set's worker, ahead in the scroll direction once the visible ones are held.
+	class RowCache
+	{
+	public:
+		using Row = std::vector<DbDataSet::ValType>;
+
+		struct Stats
+		{
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t prefetched = 0;
+		};
+
+	private:
+		std::weak_ptr<DbDataSet> m_db;
+		std::shared_ptr<ResultQueue> m_queue;
+		// requests whose rows are still wanted, by ticket
+		std::map<uint64_t, std::pair<int, int>> m_pending;
+
+		// what the rows were read for, a change drops them
+		std::weak_ptr<TableStore> m_store;
+		SortSpec m_sort;
+		RowFilter m_filter;
+		Projection m_projection;
+
+		int m_first = 0;
+		std::deque<Row> m_rows;
+		// rows in the filtered view once a read came back short, -1 until then
+		int m_end = -1;
+		// a read that failed is asked for again once this has passed
+		std::chrono::steady_clock::time_point m_retry;
+		int m_lastStart = 0;
+		int m_direction = 1;
+
+		Stats m_stats;
+
+		void reset(const std::shared_ptr<DbDataSet>& db, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection);
+		void take();
+		void cancel(bool running);
+		void merge(int first, std::vector<Row>&& rows);
+		void request(const std::shared_ptr<DbDataSet>& db, const DbTableMetaData& table, int from, int to, const fnLogger& logger);
+		void prefetch(const std::shared_ptr<DbDataSet>& db, const DbTableMetaData& table, int start, int end, const fnLogger& logger);
+
+	public:
+		RowCache();
+		virtual ~RowCache();
+
+		RowCache(const RowCache&) = delete;
+		RowCache& operator=(const RowCache&) = delete;
+
+		// Calls fnOnRow for the held rows of [start, end) of the sorted table, from start on. Rows that aren't held are
+		// requested, returns how many were delivered so the rest can be drawn as placeholders. Rows hold the projected
+		// columns only, a different projection reads them again.
+		int GetRows(const std::shared_ptr<DbDataSet>& db, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, int start, int end, const DbDataSet::fnRow& fnOnRow, const fnLogger& logger);
+
+		// end of the rows held so far, a lower bound while the count is unknown
+		int Extent() const { return m_first + int(m_rows.size()); }
+		// rows in the filtered view once a short read found them, -1 until then
+		int End() const { return m_end; }
+
+		// Drops the rows and interrupts their requests
+		void Clear();
+
+		bool Pending() const { return !m_pending.empty(); }
+		const Stats& GetStats() const { return m_stats; }
+		size_t Size() const { return m_rows.size(); }
+	};
+}
@@ -0,0 +1,94 @@
+#include "selection.hpp"
+
+#include <algorithm>
+
+namespace data
+{
+	bool RowSelection::Contains(uint32_t row) const
+	{
+		auto found = m_chunks.find(row >> chunkShift);
+		if (found == m_chunks.end())
+			return false;
+
+		const auto& bits = found->second.bits;
+		const auto local = row & (chunkRows - 1);
+		return bits.empty() || (bits[local / 64] >> (local % 64)) & 1;
+	}
+
+	void RowSelection::fill(Chunk& chunk, uint32_t from, uint32_t to)
+	{
+		if (chunk.count == chunkRows)
+			return;
+
+		if (from == 0 && to == chunkRows)
+		{
+			m_count += chunkRows - chunk.count;
+			chunk.count = chunkRows;
+			chunk.bits = {};
+			return;
+		}
+
+		if (chunk.bits.empty())
+			chunk.bits.resize(chunkWords);
+
+		while (from < to)
+		{
+			const auto word = from / 64;
+			const auto first = from % 64;
+			const auto last = std::min<uint32_t>(64, first + (to - from));
+			const auto mask = (last - first == 64 ? ~uint64_t(0) : ((uint64_t(1) << (last - first)) - 1)) << first;
+
+			const auto added = uint32_t(std::popcount(mask & ~chunk.bits[word]));
+			chunk.bits[word] |= mask;
+			chunk.count += added;
+			m_count += added;
+			from += last - first;
+		}
+
+		if (chunk.count == chunkRows)
+			chunk.bits = {};
+	}
+
+	void RowSelection::AddRange(uint32_t from, uint64_t to)
+	{
+		to = std::min<uint64_t>(to, uint64_t(UINT32_MAX) + 1);
+		for (uint64_t at = from; at < to;)
+		{
+			const auto key = uint32_t(at >> chunkShift);
+			const auto base = uint64_t(key) << chunkShift;
+			const auto end = std::min(to, base + chunkRows);
+
+			fill(m_chunks[key], uint32_t(at - base), uint32_t(end - base));
+			at = end;
+		}
+	}
+
+	void RowSelection::Remove(uint32_t row)
+	{
+		auto found = m_chunks.find(row >> chunkShift);
+		if (found == m_chunks.end())
+			return;
+
+		auto& chunk = found->second;
+		if (chunk.bits.empty())
+			chunk.bits.assign(chunkWords, ~uint64_t(0));
+
+		const auto local = row & (chunkRows - 1);
+		const auto mask = uint64_t(1) << (local % 64);
+		if (!(chunk.bits[local / 64] & mask))
+			return;
+
+		chunk.bits[local / 64] &= ~mask;
+		chunk.count--;
+		m_count--;
+
+		if (chunk.count == 0)
+			m_chunks.erase(found);
+	}
+
+	void RowSelection::Clear()
+	{
+		m_chunks.clear();
+		m_count = 0;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace data
+{
+	// Selected rows by row id, so a selection holds whatever the view's order. Ids are kept in chunks of 65536,
+	// a chunk is a bitmap until all of its rows are selected and then just a count. Membership is a map lookup
+	// and a bit test, ranges fill whole words and chunks, and the count is kept as rows come and go.
+	class RowSelection
+	{
+	private:
+		static constexpr uint32_t chunkShift = 16;
+		static constexpr uint32_t chunkRows = 1u << chunkShift;
+		static constexpr uint32_t chunkWords = chunkRows / 64;
+
+		struct Chunk
+		{
+			uint32_t count = 0;
+			// empty once the chunk is full
+			std::vector<uint64_t> bits;
+		};
+
+		std::map<uint32_t, Chunk> m_chunks;
+		uint64_t m_count = 0;
+
+		// rows [from, to) of one chunk, local to it
+		void fill(Chunk& chunk, uint32_t from, uint32_t to);
+
+	public:
+		bool Contains(uint32_t row) const;
+		uint64_t Count() const { return m_count; }
+		bool Empty() const { return m_count == 0; }
+
+		void Add(uint32_t row) { AddRange(row, uint64_t(row) + 1); }
+		// rows [from, to)
+		void AddRange(uint32_t from, uint64_t to);
+		void Remove(uint32_t row);
+		void Clear();
+
+		// Calls fn(from, to) for every run of consecutive selected rows, ascending
+		template <typename Fn>
+		void VisitRanges(Fn&& fn) const
+		{
+			uint64_t runFrom = 0, runTo = 0;
+			auto add = [&](uint64_t from, uint64_t to)
+				{
+					if (runTo != from)
+					{
+						if (runTo > runFrom)
+							fn(runFrom, runTo);
+						runFrom = from;
+					}
+					runTo = to;
+				};
+
+			for (const auto& [key, chunk] : m_chunks)
+			{
+				const uint64_t base = uint64_t(key) << chunkShift;
+				if (chunk.bits.empty())
+				{
+					add(base, base + chunkRows);
+					continue;
+				}
+
+				for (uint32_t word = 0; word < chunkWords; ++word)
+				{
+					auto bits = chunk.bits[word];
+					while (bits)
+					{
+						// a run of ones starting at the lowest set bit
+						const auto start = std::countr_zero(bits);
+						const auto length = std::countr_one(bits >> start);
+						add(base + word * 64 + start, base + word * 64 + start + length);
+						bits = length + start >= 64 ? 0 : bits & (~uint64_t(0) << (start + length));
+					}
+				}
+			}
+			if (runTo > runFrom)
+				fn(runFrom, runTo);
+		}
+	};
+}
@@ -0,0 +1,191 @@
+#include "sketch.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <numbers>
+
+namespace
+{
+	// values buffered per compressed centroid before a merge
+	constexpr size_t bufferFactor = 8;
+}
+
+namespace data
+{
+	bool ParseNumber(std::string_view text, double& value)
+	{
+		while (!text.empty() && text.front() == ' ')
+			text.remove_prefix(1);
+		while (!text.empty() && text.back() == ' ')
+			text.remove_suffix(1);
+
+		// from_chars takes no plus sign, one is allowed ahead of the digits but not of another sign
+		if (!text.empty() && text.front() == '+')
+		{
+			text.remove_prefix(1);
+			if (!text.empty() && text.front() == '-')
+				return false;
+		}
+		if (text.empty())
+			return false;
+
+		const char* end = text.data() + text.size();
+		auto [last, error] = std::from_chars(text.data(), end, value);
+		if (error == std::errc::result_out_of_range && last == end)
+		{
+			// too small for a double reads as zero, too large isn't a finite number
+			const auto e = text.find_first_of("eE");
+			value = text.front() == '-' ? -0.0 : 0.0;
+			return e != std::string_view::npos && e + 1 < text.size() && text[e + 1] == '-';
+		}
+		return error == std::errc() && last == end && std::isfinite(value);
+	}
+
+	TDigest::TDigest(double compression) : m_compression(compression)
+	{
+		m_buffer.reserve(size_t(compression) * bufferFactor);
+	}
+
+	void TDigest::Add(double value, uint64_t count)
+	{
+		if (m_weight == 0 && m_buffer.empty())
+			m_min = m_max = value;
+		m_min = std::min(m_min, value);
+		m_max = std::max(m_max, value);
+
+		m_buffer.push_back({ value, double(count) });
+		if (m_buffer.size() >= size_t(m_compression) * bufferFactor)
+			Compress();
+	}
+
+	void TDigest::Compress()
+	{
+		if (m_buffer.empty())
+			return;
+
+		auto byMean = [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; };
+		std::sort(m_buffer.begin(), m_buffer.end(), byMean);
+
+		std::vector<Centroid> all;
+		all.reserve(m_centroids.size() + m_buffer.size());
+		std::merge(m_centroids.begin(), m_centroids.end(), m_buffer.begin(), m_buffer.end(), std::back_inserter(all), byMean);
+		for (const auto& added : m_buffer)
+		{
+			m_weight += added.weight;
+		}
+		m_buffer.clear();
+
+		// a centroid spans at most one unit of k, k(q) = compression / 2pi * asin(2q - 1)
+		const double scale = m_compression / (2 * std::numbers::pi);
+		auto limit = [&](double q)
+			{
+				const double k = std::min(scale * std::asin(2 * q - 1) + 1, m_compression / 4);
+				return m_weight * (std::sin(k / scale) + 1) / 2;
+			};
+
+		m_centroids.clear();
+		double before = 0;
+		auto current = all[0];
+		double bound = limit(0);
+		for (size_t i = 1; i < all.size(); ++i)
+		{
+			if (before + current.weight + all[i].weight <= bound)
+			{
+				current.weight += all[i].weight;
+				current.mean += (all[i].mean - current.mean) * all[i].weight / current.weight;
+				continue;
+			}
+
+			before += current.weight;
+			m_centroids.push_back(current);
+			current = all[i];
+			bound = limit(before / m_weight);
+		}
+		m_centroids.push_back(current);
+	}
+
+	double TDigest::Quantile(double q) const
+	{
+		if (m_centroids.empty())
+			return std::numeric_limits<double>::quiet_NaN();
+
+		q = std::clamp(q, 0.0, 1.0);
+		if (m_centroids.size() == 1)
+			return q == 0 ? m_min : q == 1 ? m_max : m_centroids[0].mean;
+
+		// values are taken to spread evenly between the centres of neighbouring centroids, and to reach
+		// min and max from the first and last
+		const double index = q * m_weight;
+		double before = 0;
+		double previousCentre = 0;
+		double previousMean = m_min;
+		for (const auto& centroid : m_centroids)
+		{
+			const double centre = before + centroid.weight / 2;
+			if (index < centre)
+				return previousMean + (centroid.mean - previousMean) * (index - previousCentre) / (centre - previousCentre);
+
+			before += centroid.weight;
+			previousCentre = centre;
+			previousMean = centroid.mean;
+		}
+		if (m_weight <= previousCentre)
+			return m_max;
+		return previousMean + (m_max - previousMean) * (index - previousCentre) / (m_weight - previousCentre);
+	}
+
+	void Histogram::grow(double value)
+	{
+		if (m_width == 0)
+		{
+			// the values so far were all equal, they end up at the low end or the middle
+			const double span = std::abs(value - m_low);
+			m_width = span / (bins / 2);
+			if (m_width == 0 || !std::isfinite(m_width))
+				m_width = std::max(std::abs(m_low), 1.0) * std::numeric_limits<double>::epsilon();
+			if (value < m_low)
+			{
+				m_counts[bins / 2] = m_counts[0];
+				m_counts[0] = 0;
+				m_low -= m_width * (bins / 2);
+			}
+			return;
+		}
+
+		// doubling toward the value, up keeps the low end, down moves it by the old range
+		std::array<uint64_t, bins> merged{};
+		const int offset = value < m_low ? bins / 2 : 0;
+		for (int i = 0; i < bins; ++i)
+		{
+			merged[offset + i / 2] += m_counts[i];
+		}
+		if (value < m_low)
+			m_low -= m_width * bins;
+		m_width *= 2;
+		m_counts = merged;
+	}
+
+	void Histogram::Add(double value, uint64_t count)
+	{
+		if (count == 0)
+			return;
+
+		if (m_count == 0 || (m_width == 0 && value == m_low))
+		{
+			m_low = value;
+			m_counts[0] += count;
+			m_count += count;
+			return;
+		}
+		m_count += count;
+
+		while (value < m_low || value >= m_low + m_width * bins)
+			grow(value);
+
+		const auto bin = std::clamp(int((value - m_low) / m_width), 0, bins - 1);
+		m_counts[bin] += count;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace data
+{
+	// Reads text as a number the way a column of them is usually written, surrounding spaces and a leading plus
+	// allowed, with from_chars. Returns false for text that isn't a finite number.
+	bool ParseNumber(std::string_view text, double& value);
+
+	// Quantiles of a stream of values in bounded memory. Values are buffered and merged into centroids that are
+	// small at the tails and large in the middle, so p99 stays sharp while p50 is still close.
+	class TDigest
+	{
+	private:
+		struct Centroid
+		{
+			double mean = 0;
+			double weight = 0;
+		};
+
+		double m_compression;
+		std::vector<Centroid> m_centroids;
+		std::vector<Centroid> m_buffer;
+		double m_weight = 0;
+		double m_min = 0;
+		double m_max = 0;
+
+	public:
+		explicit TDigest(double compression = 200);
+
+		// value seen count times
+		void Add(double value, uint64_t count = 1);
+		// Merges the buffered values, Quantile sees what was merged
+		void Compress();
+
+		// q in [0, 1], NaN while empty
+		double Quantile(double q) const;
+		uint64_t Count() const { return uint64_t(m_weight); }
+		size_t Centroids() const { return m_centroids.size(); }
+	};
+
+	// Exact counts in a fixed number of equal bins. The range starts at the first values and doubles toward
+	// any value outside it, pairs of bins merging, so no pass is needed to find it first.
+	class Histogram
+	{
+	public:
+		static constexpr int bins = 64;
+
+	private:
+		std::array<uint64_t, bins> m_counts{};
+		double m_low = 0;
+		double m_width = 0;
+		uint64_t m_count = 0;
+
+		void grow(double value);
+
+	public:
+		void Add(double value, uint64_t count = 1);
+
+		// bin i holds [Low() + i * Width(), Low() + (i + 1) * Width()), all in bin 0 while the values were equal
+		double Low() const { return m_low; }
+		double Width() const { return m_width; }
+		const std::array<uint64_t, bins>& Counts() const { return m_counts; }
+		uint64_t Count() const { return m_count; }
+	};
+}
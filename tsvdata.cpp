@@ -1,429 +1,4006 @@
-#include "tsvdata.hpp"
-
-#include <algorithm>
-#include <fstream>
-#include <assert.h>
-
-namespace
-{
-	struct TableDesc
-	{
-		std::string name;
-		std::vector<std::string> columns;
-	};
-
-	void parseTabs(const std::string& line, std::vector<std::string>& parts)
-	{
-		size_t iter = 0;
-		while (true)
-		{
-			auto end = line.find('\t', iter);
-
-			auto col = line.substr(iter, end - iter);
-
-			while (!col.empty() && (col[col.size() - 1] == '\n' || col[col.size() - 1] == '\r'))
-				col.resize(col.size() - 1);
-
-			parts.push_back(col);
-			if (end != std::string::npos)
-				iter = end + 1;
-			else
-				break;
-		}
-	}
-
-	static int callback(void* NotUsed, int argc, char** argv, char** azColName) {
-		int i;
-		for (i = 0; i < argc; i++) {
-			printf("%s = %s\n", azColName[i], argv[i] ? argv[i] : "NULL");
-		}
-		printf("\n");
-		return 0;
-	}
-
-	TableDesc createTable(sqlite3 *db, std::string name, const std::string& line)
-	{
-		assert(db);
-
-		auto escapeName = [](std::string s) -> const std::string
-			{
-				auto pos = s.find("-");
-				while (pos != std::string::npos)
-				{
-					s[pos] = '_';
-					pos = s.find("-", pos + 1);
-				}
-				return s;
-
-			};
-
-
-		TableDesc ret;
-		ret.name = escapeName(std::move(name));
-		ret.columns.push_back("row_id");
-		parseTabs(line, ret.columns);
-
-		std::stringstream ss;
-
-		auto escape = [](std::string s) -> const std::string
-			{
-				auto pos = s.find(" ");
-				while (pos != std::string::npos)
-				{
-					s[pos] = '_';
-					pos = s.find(" ", pos + 1);
-				}
-				return s;
-
-			};
-
-		ss << "CREATE TABLE " << ret.name << " (\n";
-		ss << "'" << "row_id" << "' INT,\n";
-		for (auto it = ret.columns.begin() + 1; it != ret.columns.end(); ++it)
-		{
-			ss << "'" << escape(*it) << "' TEXT,\n";
-		}
-
-		auto str = ss.str();
-		str.resize(str.size() - 2);
-		str.append(");");
-
-		char* zErrMsg = nullptr;
-		auto rc = sqlite3_exec(db, str.c_str(), callback, 0, &zErrMsg);
-		if (rc != SQLITE_OK) {
-			throw new data::create_failure{};
-		}
-
-		return ret;
-	}
-
-	struct insertContext
-	{
-		std::string prefix;
-		std::stringstream ss;
-		size_t count = 0;
-		size_t wrote = 0;
-	};
-
-	insertContext insertBegin(const TableDesc& info)
-	{
-		insertContext ret;
-
-		std::stringstream ss;
-		ss << "INSERT INTO `" << info.name << "` VALUES \n";
-
-		ret.prefix = ss.str();
-
-		return ret;
-	}
-
-	void insertEnd(sqlite3* db, const TableDesc& info, insertContext& ctx)
-	{
-		if (ctx.count)
-		{
-			char* zErrMsg = nullptr;
-			auto str = ctx.ss.str();
-			auto rc = sqlite3_exec(db, str.c_str(), callback, 0, &zErrMsg);
-			if (rc != SQLITE_OK) {
-				throw new data::insert_failure{};
-			}
-
-			ctx.wrote += ctx.count;
-			ctx.count = 0;
-			ctx.ss.clear();
-		}
-	}
-
-	constexpr size_t batchSize = 2000;
-
-	void insertTable(sqlite3* db, int id, TableDesc info, insertContext& ctx, const std::string& line)
-	{
-		assert(db);
-
-		std::vector<std::string> values;
-		parseTabs(line, values);
-
-		auto escape = [](std::string s) -> const std::string
-			{
-				auto pos = s.find("\'");
-				while (pos != std::string::npos)
-				{
-					s.insert(pos, "\'");
-					pos = s.find("\'",pos + 2);
-				}
-				return s;
-
-			};
-
-		if (!ctx.count)
-		{
-			ctx.ss << ctx.prefix;
-		}
-		else
-		{
-			ctx.ss << ",";
-		}
-
-		ctx.ss << "(";
-
-		ctx.ss << id;
-		ctx.ss << ",\n";
-
-		for (const auto& val : values)
-		{
-			ctx.ss << "\'" << escape(val) << "\',\n";
-		}
-		for (auto i = values.size()+1; i < info.columns.size(); i++)
-		{
-			ctx.ss << "NULL,\n";
-		}
-
-		ctx.ss.seekp(size_t(ctx.ss.tellp()) - 2);
-
-		ctx.ss << ")\n";
-
-		if (++ctx.count >= batchSize)
-		{
-			char* zErrMsg = nullptr;
-			auto str = ctx.ss.str();
-			auto rc = sqlite3_exec(db, str.c_str(), callback, 0, &zErrMsg);
-			if (rc != SQLITE_OK) {
-				throw new data::insert_failure{};
-			}
-
-			ctx.wrote += ctx.count;
-			ctx.count = 0;
-			std::stringstream ss;
-			std::swap(ctx.ss, ss);
-		}
-	}
-
-}
-
-namespace data
-{
-
-	DbDataSet::DbDataSet()
-	{
-		auto rc = sqlite3_open(":memory:", &db);
-		if (rc)
-		{
-			throw new data::failed_db_create();
-		}
-	}
-
-	DbDataSet::~DbDataSet()
-	{
-		assert(db);
-		sqlite3_close(db);
-
-	}
-
-#define LOG_TO(l, ...)        \
-	{                         \
-		std::stringstream ss; \
-		ss << __VA_ARGS__;    \
-        l(ss.str());          \
-	}
-
-	const DbMetaData& DbDataSet::GetTableMetaData()
-	{
-		return m_meta;
-	}
-
-	int DbDataSet::GetRowCount(const DbTableMetaData& table, const fnLogger& logger)
-	{
-		int retCount = 0;
-
-		std::string sql;
-		sql.append("SELECT COUNT(*) FROM `");
-		sql.append(table.table_name);
-		sql.append("`");
-		sql.append(";");
-
-		sqlite3_stmt* stmt = nullptr;
-
-		int ret = sqlite3_prepare_v2(
-			db,
-			sql.c_str(),
-			int(sql.size()),
-			&stmt,
-			nullptr);
-
-		if (ret != SQLITE_OK)
-		{
-			LOG_TO(logger, "Failed to exec " << sql << " error " << ret << "\n");
-			sqlite3_finalize(stmt);
-			return retCount;
-		}
-
-		bool stepping = true;
-		while (stepping)
-		{
-			ret = sqlite3_step(stmt);
-			switch (ret)
-			{
-			case SQLITE_ROW:
-				ret = sqlite3_column_int(stmt, 0);
-				break;
-			case SQLITE_DONE:
-				stepping = false;
-				break;
-			default:
-				LOG_TO(logger, "Failed stepping " << sql << " error " << ret << "\n");
-				stepping = false;
-				break;
-			}
-		}
-
-		return retCount;
-	}
-
-	void DbDataSet::GetRows(const DbTableMetaData& table, const std::string& sort, std::function<void(const std::vector<ValType>&)> fnOnRow, const fnLogger& logger, int limit, int offset)
-	{
-		static std::vector<ValType> row_data;
-
-		std::stringstream ss;
-
-		ss << "SELECT * FROM `" << table.table_name << "`";
-		if (!sort.empty())
-		{
-			ss << " ORDER BY " << sort;
-		}
-		if (limit)
-		{
-			ss << " LIMIT " << limit;
-			if (offset)
-			{
-				ss << " OFFSET " << offset;
-			}
-		}
-		ss << ";";
-
-		sqlite3_stmt* stmt = nullptr;
-
-		int ret = sqlite3_prepare_v2(
-			db,
-			ss.str().c_str(),
-			int(ss.str().size()),
-			&stmt,
-			nullptr);
-
-		if (ret != SQLITE_OK)
-		{
-			LOG_TO(logger, "Failed to exec " << ss.str() << " error " << ret << "\n");
-			sqlite3_finalize(stmt);
-			return;
-		}
-
-		bool stepping = true;
-		while (stepping)
-		{
-			row_data.clear();
-			row_data.reserve(table.columns.size());
-
-			ret = sqlite3_step(stmt);
-			switch (ret)
-			{
-			case SQLITE_ROW:
-
-				row_data.emplace_back(sqlite3_column_int(stmt, 0));
-
-				for (int i = 1; i < int(table.columns.size()); ++i)
-				{
-					auto sz = sqlite3_column_bytes(stmt, i);
-					const unsigned char* data = sqlite3_column_text(stmt, i);
-					row_data.emplace_back(std::string(data, data + size_t(sz)));
-				}
-
-				fnOnRow(row_data);
-				break;
-			case SQLITE_DONE:
-				stepping = false;
-				break;
-			default:
-				LOG_TO(logger, "Failed stepping " << ss.str() << " error " << ret << "\n");
-				stepping = false;
-				break;
-			}
-		}
-	}
-
-	void DbDataSet::LoadFromPath(const std::string& path, const std::string& pattern, const fnLogger& logger)
-	{
-		DbMetaData ret;
-		if (!std::filesystem::exists(path))
-		{
-			LOG_TO(logger, "Couldn't find file " << path << "\n");
-			throw new folder_not_found();
-		}
-
-		LOG_TO(logger, "Loading from path " << path << "\n");
-		for (auto const& item : std::filesystem::directory_iterator(path))
-		{
-			if (item.is_regular_file())
-			{
-				std::wstring wide_path(item.path());
-				auto found = std::ranges::search(wide_path, pattern);
-				if (!found.empty())
-				{
-					ret.tables.emplace_back(LoadTsvFile(item.path(), logger));
-				}
-			}
-		}
-
-		m_meta = ret;
-		m_path = path;
-		m_pattern = pattern;
-	}
-
-	DbTableMetaData DbDataSet::LoadTsvFile(const std::filesystem::path& path, const fnLogger& logger)
-	{
-		DbTableMetaData ret{};
-
-		ret.file_name = path.string();
-
-		std::ifstream in(path.string(), std::ios::binary);
-		if (!in.is_open())
-		{
-			LOG_TO(logger, "Failed to open: " << path << "\n");
-			throw new file_not_found{path.string()};
-		}
-
-		int lineNo = 0;
-		TableDesc desc{};
-
-		insertContext ctx;
-
-		int nextId = 0;
-
-		for (std::string line; std::getline(in, line);)
-		{
-			if (lineNo++ == 0)
-			{
-				auto name = path.filename().string();
-				name = name.substr(0, name.find("."));
-				desc = createTable(db, name, line);
-				
-				ret.table_name = desc.name;
-				ret.columns = desc.columns;
-
-				ctx = insertBegin(desc);
-			}
-			else
-			{
-				insertTable(db, nextId++, desc, ctx, line);
-			}
-			// LOG_TO(logger, path << ": line: " << ++lineNo << " Had len " << line.size() << "\n");
-		}
-
-		insertEnd(db, desc, ctx);
-
-		ret.count = ctx.wrote;
-
-		LOG_TO(logger, path << " loaded " << ctx.wrote << " lines\n");
-
-		return ret;
-	}
-
+#include "tsvdata.hpp"
+#include "sketch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <assert.h>
+
+namespace
+{
+	// Sampled rows decide which columns get a dictionary
+	constexpr size_t dictionarySampleRows = 8192;
+	constexpr size_t dictionaryMinRows = 512;
+	constexpr size_t dictionaryMaxValues = 4096;
+	constexpr size_t dictionaryMinRepeat = 16;
+
+	// Low cardinality column stored as integer codes. Codes follow the byte order of the values, so the
+	// code column sorts and range compares exactly like the text it replaces.
+	struct ColumnDictionary
+	{
+		std::unordered_map<std::string, int> codes;
+		std::vector<std::string> values;
+		bool ordered = true;
+		// the column turned out to have more values than a dictionary takes, it goes back to text
+		bool overflowed = false;
+		size_t textBytes = 0;
+		size_t rows = 0;
+
+		// -1 once overflowed, the value is then stored as text
+		int Encode(const std::string& value)
+		{
+			if (overflowed)
+				return -1;
+
+			textBytes += value.size();
+			rows++;
+
+			auto found = codes.find(value);
+			if (found != codes.end())
+				return found->second;
+
+			if (values.size() >= dictionaryMaxValues)
+			{
+				overflowed = true;
+				return -1;
+			}
+
+			if (!values.empty() && values.back() > value)
+				ordered = false;
+
+			int code = int(values.size());
+			codes.emplace(value, code);
+			values.push_back(value);
+			return code;
+		}
+	};
+
+	struct TableDesc
+	{
+		std::string name;
+		std::vector<std::string> columns;
+		std::vector<std::unique_ptr<ColumnDictionary>> dictionaries;
+		// what every value of each column narrows to as it is inserted, an Arrow export reads it off the store
+		std::vector<data::ArrowType> types;
+	};
+
+	void parseTabs(std::string_view line, std::vector<std::string>& parts)
+	{
+		size_t iter = 0;
+		while (true)
+		{
+			auto end = line.find('\t', iter);
+
+			auto col = line.substr(iter, end - iter);
+
+			while (!col.empty() && (col[col.size() - 1] == '\n' || col[col.size() - 1] == '\r'))
+				col.remove_suffix(1);
+
+			parts.emplace_back(col);
+			if (end != std::string::npos)
+				iter = end + 1;
+			else
+				break;
+		}
+	}
+
+	static int callback(void* NotUsed, int argc, char** argv, char** azColName) {
+		int i;
+		for (i = 0; i < argc; i++) {
+			printf("%s = %s\n", azColName[i], argv[i] ? argv[i] : "NULL");
+		}
+		printf("\n");
+		return 0;
+	}
+
+	struct StopWatch
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		double Seconds() const
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	};
+
+	std::string escapeName(std::string s)
+	{
+		auto pos = s.find("-");
+		while (pos != std::string::npos)
+		{
+			s[pos] = '_';
+			pos = s.find("-", pos + 1);
+		}
+		return s;
+	}
+
+	std::string escapeColumn(std::string s)
+	{
+		auto pos = s.find(" ");
+		while (pos != std::string::npos)
+		{
+			s[pos] = '_';
+			pos = s.find(" ", pos + 1);
+		}
+		return s;
+	}
+
+	std::string dictionaryTable(const std::string& table, size_t column)
+	{
+		std::stringstream ss;
+		ss << table << "__dict_" << column;
+		return ss.str();
+	}
+
+	void exec(sqlite3* db, const std::string& sql)
+	{
+		char* zErrMsg = nullptr;
+		auto rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &zErrMsg);
+		sqlite3_free(zErrMsg);
+		if (rc != SQLITE_OK) {
+			throw new data::create_failure{};
+		}
+	}
+
+	TableDesc createTable(sqlite3 *db, std::string name, std::string_view line, const std::vector<std::string>& sample)
+	{
+		assert(db);
+
+		TableDesc ret;
+		ret.name = escapeName(std::move(name));
+		ret.columns.push_back("row_id");
+		parseTabs(line, ret.columns);
+
+		ret.dictionaries.resize(ret.columns.size());
+		ret.types.assign(ret.columns.size(), data::ArrowType::Int64);
+
+		if (sample.size() >= dictionaryMinRows)
+		{
+			std::vector<std::map<std::string, size_t>> distinct(ret.columns.size());
+			std::vector<std::string> values;
+			for (const auto& row : sample)
+			{
+				values.clear();
+				parseTabs(row, values);
+				for (size_t i = 0; i < values.size() && i + 1 < distinct.size(); ++i)
+				{
+					if (distinct[i + 1].size() <= dictionaryMaxValues)
+						distinct[i + 1][values[i]]++;
+				}
+			}
+
+			for (size_t i = 1; i < distinct.size(); ++i)
+			{
+				const auto count = distinct[i].size();
+				if (count == 0 || count > dictionaryMaxValues || count * dictionaryMinRepeat > sample.size())
+					continue;
+
+				// seed with the sorted sample so codes start out in value order
+				auto dict = std::make_unique<ColumnDictionary>();
+				for (const auto& [value, uses] : distinct[i])
+				{
+					dict->codes.emplace(value, int(dict->values.size()));
+					dict->values.push_back(value);
+				}
+				ret.dictionaries[i] = std::move(dict);
+			}
+		}
+
+		std::stringstream ss;
+
+		// dictionary columns have no affinity, so text written once one overflows stays text next to the codes
+		ss << "CREATE TABLE " << ret.name << " (\n";
+		ss << "'" << "row_id" << "' INTEGER PRIMARY KEY,\n";
+		for (size_t i = 1; i < ret.columns.size(); ++i)
+		{
+			ss << "'" << escapeColumn(ret.columns[i]) << (ret.dictionaries[i] ? "',\n" : "' TEXT,\n");
+		}
+
+		auto str = ss.str();
+		str.resize(str.size() - 2);
+		str.append(");");
+
+		exec(db, str);
+
+		for (size_t i = 1; i < ret.columns.size(); ++i)
+		{
+			if (ret.dictionaries[i])
+			{
+				exec(db, "CREATE TABLE " + dictionaryTable(ret.name, i) + " (code INTEGER PRIMARY KEY, value TEXT);");
+			}
+		}
+
+		return ret;
+	}
+
+	// Bytes sqlite needs for an integer column value
+	size_t integerBytes(size_t maxValue)
+	{
+		if (maxValue <= 1) return 0;
+		if (maxValue <= 0x7F) return 1;
+		if (maxValue <= 0x7FFF) return 2;
+		if (maxValue <= 0x7FFFFF) return 3;
+		return 4;
+	}
+
+	// Stores the dictionaries next to the table, renumbering codes first if values arrived out of order. An
+	// overflowed one decodes the codes written before it did and is dropped, leaving a plain text column.
+	size_t finishDictionaries(sqlite3* db, TableDesc& desc, std::vector<std::vector<std::string>>& out)
+	{
+		size_t saved = 0;
+
+		out.resize(desc.columns.size());
+
+		for (size_t i = 1; i < desc.dictionaries.size(); ++i)
+		{
+			auto& dict = desc.dictionaries[i];
+			if (!dict)
+				continue;
+
+			const auto column = "`" + escapeColumn(desc.columns[i]) + "`";
+
+			if (!dict->ordered && !dict->overflowed)
+			{
+				std::vector<int> order(dict->values.size());
+				for (int code = 0; code < int(order.size()); ++code)
+					order[code] = code;
+				std::sort(order.begin(), order.end(), [&](int a, int b) { return dict->values[a] < dict->values[b]; });
+
+				exec(db, "CREATE TEMP TABLE dict_remap (code INTEGER PRIMARY KEY, rank INT);");
+
+				sqlite3_stmt* remap = nullptr;
+				if (sqlite3_prepare_v2(db, "INSERT INTO dict_remap VALUES (?, ?);", -1, &remap, nullptr) != SQLITE_OK)
+				{
+					throw new data::insert_failure{};
+				}
+
+				std::vector<std::string> sorted(order.size());
+				for (int rank = 0; rank < int(order.size()); ++rank)
+				{
+					sorted[rank] = std::move(dict->values[order[rank]]);
+
+					sqlite3_bind_int(remap, 1, order[rank]);
+					sqlite3_bind_int(remap, 2, rank);
+					auto rc = sqlite3_step(remap);
+					sqlite3_reset(remap);
+					if (rc != SQLITE_DONE)
+					{
+						sqlite3_finalize(remap);
+						throw new data::insert_failure{};
+					}
+				}
+				sqlite3_finalize(remap);
+
+				exec(db, "UPDATE `" + desc.name + "` SET " + column + " = (SELECT rank FROM dict_remap WHERE code = " + column + ");");
+				exec(db, "DROP TABLE dict_remap;");
+
+				dict->values = std::move(sorted);
+			}
+
+			sqlite3_stmt* stmt = nullptr;
+			auto sql = "INSERT INTO " + dictionaryTable(desc.name, i) + " VALUES (?, ?);";
+			if (sqlite3_prepare_v2(db, sql.c_str(), int(sql.size()), &stmt, nullptr) != SQLITE_OK)
+			{
+				throw new data::insert_failure{};
+			}
+
+			size_t dictBytes = 0;
+			for (int code = 0; code < int(dict->values.size()); ++code)
+			{
+				const auto& value = dict->values[code];
+				dictBytes += value.size();
+
+				sqlite3_bind_int(stmt, 1, code);
+				sqlite3_bind_text(stmt, 2, value.c_str(), int(value.size()), SQLITE_STATIC);
+				auto rc = sqlite3_step(stmt);
+				sqlite3_reset(stmt);
+				if (rc != SQLITE_DONE)
+				{
+					sqlite3_finalize(stmt);
+					throw new data::insert_failure{};
+				}
+			}
+			sqlite3_finalize(stmt);
+
+			if (dict->overflowed)
+			{
+				const auto values = "`" + dictionaryTable(desc.name, i) + "`";
+				exec(db, "UPDATE `" + desc.name + "` SET " + column + " = (SELECT value FROM " + values + " WHERE code = " + column + ") WHERE typeof(" + column + ") = 'integer';");
+				exec(db, "DROP TABLE " + values + ";");
+				continue;
+			}
+
+			const auto encoded = dict->rows * integerBytes(dict->values.size() - 1) + dictBytes;
+			if (dict->textBytes > encoded)
+				saved += dict->textBytes - encoded;
+
+			out[i] = std::move(dict->values);
+		}
+
+		return saved;
+	}
+
+	struct insertContext
+	{
+		std::string prefix;
+		std::stringstream ss;
+		size_t count = 0;
+		size_t wrote = 0;
+		double execSeconds = 0;
+	};
+
+	insertContext insertBegin(const TableDesc& info)
+	{
+		insertContext ret;
+
+		std::stringstream ss;
+		ss << "INSERT INTO `" << info.name << "` VALUES \n";
+
+		ret.prefix = ss.str();
+
+		return ret;
+	}
+
+	void insertEnd(sqlite3* db, const TableDesc& info, insertContext& ctx)
+	{
+		if (ctx.count)
+		{
+			char* zErrMsg = nullptr;
+			auto str = ctx.ss.str();
+			StopWatch exec;
+			auto rc = sqlite3_exec(db, str.c_str(), callback, 0, &zErrMsg);
+			ctx.execSeconds += exec.Seconds();
+			if (rc != SQLITE_OK) {
+				throw new data::insert_failure{};
+			}
+
+			ctx.wrote += ctx.count;
+			ctx.count = 0;
+			ctx.ss.clear();
+		}
+	}
+
+	constexpr size_t batchSize = 2000;
+
+	void insertTable(sqlite3* db, int id, TableDesc& info, insertContext& ctx, std::string_view line)
+	{
+		assert(db);
+
+		std::vector<std::string> values;
+		parseTabs(line, values);
+
+		auto escape = [](std::string s) -> const std::string
+			{
+				auto pos = s.find("\'");
+				while (pos != std::string::npos)
+				{
+					s.insert(pos, "\'");
+					pos = s.find("\'",pos + 2);
+				}
+				return s;
+
+			};
+
+		if (!ctx.count)
+		{
+			ctx.ss << ctx.prefix;
+		}
+		else
+		{
+			ctx.ss << ",";
+		}
+
+		ctx.ss << "(";
+
+		ctx.ss << id;
+		ctx.ss << ",\n";
+
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			if (i + 1 < info.types.size() && info.types[i + 1] != data::ArrowType::Utf8)
+				info.types[i + 1] = data::NarrowArrowType(info.types[i + 1], values[i]);
+			const int code = i + 1 < info.dictionaries.size() && info.dictionaries[i + 1] ? info.dictionaries[i + 1]->Encode(values[i]) : -1;
+			if (code >= 0)
+				ctx.ss << code << ",\n";
+			else
+				ctx.ss << "\'" << escape(values[i]) << "\',\n";
+		}
+		// missing trailing fields are empty rather than NULL so every row compares in seeks
+		for (auto i = values.size()+1; i < info.columns.size(); i++)
+		{
+			const int code = info.dictionaries[i] ? info.dictionaries[i]->Encode("") : -1;
+			if (code >= 0)
+				ctx.ss << code << ",\n";
+			else
+				ctx.ss << "'',\n";
+		}
+
+		ctx.ss.seekp(size_t(ctx.ss.tellp()) - 2);
+
+		ctx.ss << ")\n";
+
+		if (++ctx.count >= batchSize)
+		{
+			char* zErrMsg = nullptr;
+			auto str = ctx.ss.str();
+			StopWatch exec;
+			auto rc = sqlite3_exec(db, str.c_str(), callback, 0, &zErrMsg);
+			ctx.execSeconds += exec.Seconds();
+			if (rc != SQLITE_OK) {
+				throw new data::insert_failure{};
+			}
+
+			ctx.wrote += ctx.count;
+			ctx.count = 0;
+			std::stringstream ss;
+			std::swap(ctx.ss, ss);
+		}
+	}
+
+	constexpr size_t readBlockSize = 4 << 20;
+
+	// Hands out the lines of a file as UTF-8, reading it in large blocks.
+	// UTF-8 input is read straight into the line buffer and only validated, other encodings are transcoded per block.
+	class LineReader
+	{
+		std::ifstream& in;
+		codec::Encoding encoding = codec::Encoding::Utf8;
+		std::string buffer;
+		size_t pos = 0;
+		size_t checked = 0;
+		std::vector<char> raw;
+		size_t rawSize = 0;
+		bool eof = false;
+		double seconds = 0;
+		uint64_t bytes = 0;
+
+		size_t read(char* into, size_t size)
+		{
+			in.read(into, std::streamsize(size));
+			auto got = size_t(in.gcount());
+			bytes += got;
+			if (got < size)
+				eof = true;
+			return got;
+		}
+
+		// validates the new UTF-8 up to end, replacing anything malformed
+		void check(size_t end)
+		{
+			auto bad = checked + codec::ValidateUtf8(buffer.data() + checked, end - checked);
+			if (bad < end)
+			{
+				std::string repaired;
+				codec::ToUtf8(codec::Encoding::Utf8, buffer.data() + bad, end - bad, repaired, true);
+				buffer.replace(bad, end - bad, repaired);
+				end = bad + repaired.size();
+			}
+			checked = end;
+		}
+
+		bool fill()
+		{
+			if (eof)
+				return false;
+
+			StopWatch watch;
+
+			buffer.erase(0, pos);
+			checked -= pos;
+			pos = 0;
+
+			if (encoding == codec::Encoding::Utf8 || encoding == codec::Encoding::Utf8Bom)
+			{
+				auto old = buffer.size();
+				buffer.resize(old + readBlockSize);
+				buffer.resize(old + read(buffer.data() + old, readBlockSize));
+
+				// only complete lines are checked, a character can't straddle a newline
+				auto last = eof ? buffer.size() : buffer.rfind('\n');
+				if (last != std::string::npos && last >= checked)
+					check(eof ? last : last + 1);
+			}
+			else
+			{
+				raw.resize(rawSize + readBlockSize);
+				rawSize += read(raw.data() + rawSize, readBlockSize);
+
+				auto used = codec::ToUtf8(encoding, raw.data(), rawSize, buffer, eof);
+				memmove(raw.data(), raw.data() + used, rawSize - used);
+				rawSize -= used;
+				checked = buffer.size();
+			}
+
+			seconds += watch.Seconds();
+			return true;
+		}
+
+	public:
+		explicit LineReader(std::ifstream& file) : in(file)
+		{
+			StopWatch watch;
+
+			raw.resize(readBlockSize);
+			rawSize = read(raw.data(), raw.size());
+
+			size_t bom = 0;
+			encoding = codec::Detect(raw.data(), rawSize, bom);
+
+			if (encoding == codec::Encoding::Utf8 || encoding == codec::Encoding::Utf8Bom)
+			{
+				buffer.assign(raw.data() + bom, rawSize - bom);
+				rawSize = 0;
+				auto last = eof ? buffer.size() : buffer.rfind('\n');
+				if (last != std::string::npos)
+					check(eof ? last : last + 1);
+			}
+			else
+			{
+				memmove(raw.data(), raw.data() + bom, rawSize - bom);
+				rawSize -= bom;
+				auto used = codec::ToUtf8(encoding, raw.data(), rawSize, buffer, eof);
+				memmove(raw.data(), raw.data() + used, rawSize - used);
+				rawSize -= used;
+				checked = buffer.size();
+			}
+
+			seconds += watch.Seconds();
+		}
+
+		codec::Encoding Encoding() const { return encoding; }
+
+		// time spent reading and decoding, and bytes read from the file
+		double Seconds() const { return seconds; }
+		uint64_t Bytes() const { return bytes; }
+
+		// the view stays valid until the next call
+		bool Next(std::string_view& line)
+		{
+			while (true)
+			{
+				auto nl = checked > pos ? static_cast<const char*>(memchr(buffer.data() + pos, '\n', checked - pos)) : nullptr;
+				if (nl)
+				{
+					auto end = size_t(nl - buffer.data());
+					line = std::string_view(buffer.data() + pos, end - pos);
+					pos = end + 1;
+					return true;
+				}
+
+				if (!fill())
+				{
+					if (pos < buffer.size())
+					{
+						line = std::string_view(buffer.data() + pos, buffer.size() - pos);
+						pos = buffer.size();
+						return true;
+					}
+					return false;
+				}
+			}
+		}
+	};
+
+	// Every checkpointStride-th position of a sort order is kept, so no page reads past more rows than that
+	constexpr int checkpointStride = 1024;
+	constexpr size_t maxSeenPositions = 256;
+
+	// rows and copied text per RowBatch
+	constexpr size_t batchRows = 256;
+	constexpr size_t batchTextBytes = 256 * 1024;
+
+	// filtered counts kept per data set
+	constexpr size_t maxCountEntries = 256;
+	// smaller tables are counted before a sample would help
+	constexpr int64_t estimateMinRows = 65536;
+	constexpr int64_t estimateBlocks = 16;
+	constexpr int64_t estimateBlockRows = 256;
+
+	// group bys and profiles scan the table in blocks of row ids, publishing what they have at most this often
+	constexpr int64_t scanBlockRows = 65536;
+	constexpr int scanPublishMs = 250;
+	// groups past this many are left out and the result marked truncated
+	constexpr size_t maxGroups = 1 << 20;
+	// group bys and profiles kept per data set
+	constexpr size_t maxGroupJobs = 16;
+	constexpr size_t maxProfileJobs = 32;
+
+	// pairs a join keeps at most, 512 MB of them
+	constexpr uint64_t maxJoinPairs = uint64_t(1) << 26;
+
+	// the ValType row API on top of batches, row ids stay int and every other cell becomes text
+	template <typename Fn>
+	void deliverRows(const data::RowBatch& batch, std::vector<data::DbDataSet::ValType>& row, const Fn& fnOnRow)
+	{
+		for (size_t r = 0; r < batch.rows; ++r)
+		{
+			auto cells = batch.Row(r);
+
+			row.clear();
+			row.emplace_back(int(std::get<int64_t>(cells[0])));
+			for (size_t i = 1; i < cells.size(); ++i)
+			{
+				std::visit([&](const auto& cell)
+					{
+						if constexpr (std::is_same_v<std::decay_t<decltype(cell)>, std::string_view>)
+							row.emplace_back(std::string(cell));
+						else
+							row.emplace_back(std::to_string(cell));
+					}, cells[i]);
+			}
+			fnOnRow(row);
+		}
+	}
+
+	// Turns the rows of statements selecting the given table columns, row_id first, into batches in a read context's buffers
+	class BatchWriter
+	{
+		const data::BatchSink& m_sink;
+		const std::vector<std::vector<std::string>>& m_dictionaries;
+		const std::vector<int>& m_projection;
+		const size_t m_columns;
+		std::vector<data::CellView>& m_cells;
+		std::string& m_text;
+		// of the row being added, every call into sqlite costs so each is asked once
+		std::vector<int> m_types;
+		std::vector<int> m_bytes;
+		const bool m_codes;
+
+	public:
+		BatchWriter(data::ReadContext& ctx, const data::DbTableMetaData& table, const std::vector<int>& columns, const data::BatchSink& sink)
+			: m_sink(sink), m_dictionaries(table.store->dictionaries), m_projection(columns), m_columns(columns.size()), m_cells(ctx.batchCells), m_text(ctx.batchText), m_types(columns.size()), m_bytes(columns.size()), m_codes(ctx.dictionaryCodes)
+		{
+			m_cells.clear();
+			m_text.clear();
+			if (m_text.capacity() < batchTextBytes)
+				m_text.reserve(batchTextBytes);
+		}
+
+		BatchWriter(const BatchWriter&) = delete;
+		BatchWriter& operator=(const BatchWriter&) = delete;
+
+		void Flush()
+		{
+			if (m_cells.empty())
+				return;
+			m_sink(data::RowBatch{ m_cells.data(), m_columns, m_cells.size() / m_columns });
+			m_cells.clear();
+			m_text.clear();
+		}
+
+		void Add(sqlite3_stmt* stmt)
+		{
+			// text is copied out since sqlite only keeps it until the next step, the batch goes
+			// out early rather than letting the buffer move under the views already taken
+			size_t rowText = 0;
+			for (int i = 1; i < int(m_columns); ++i)
+			{
+				m_types[i] = sqlite3_column_type(stmt, i);
+				if (m_types[i] == SQLITE_TEXT && m_dictionaries[m_projection[i]].empty())
+				{
+					m_bytes[i] = sqlite3_column_bytes(stmt, i);
+					rowText += size_t(m_bytes[i]);
+				}
+			}
+			if (m_text.size() + rowText > m_text.capacity() || m_cells.size() >= batchRows * m_columns)
+			{
+				Flush();
+				if (rowText > m_text.capacity())
+					m_text.reserve(rowText);
+			}
+
+			m_cells.emplace_back(sqlite3_column_int64(stmt, 0));
+
+			for (int i = 1; i < int(m_columns); ++i)
+			{
+				const auto& dict = m_dictionaries[m_projection[i]];
+				if (!dict.empty())
+				{
+					auto code = m_types[i] == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, i);
+					if (m_codes)
+					{
+						m_cells.emplace_back(int64_t(code));
+						continue;
+					}
+					m_cells.emplace_back(code >= 0 && code < int(dict.size()) ? std::string_view(dict[code]) : std::string_view());
+					continue;
+				}
+
+				switch (m_types[i])
+				{
+				case SQLITE_INTEGER:
+					m_cells.emplace_back(int64_t(sqlite3_column_int64(stmt, i)));
+					break;
+				case SQLITE_FLOAT:
+					m_cells.emplace_back(sqlite3_column_double(stmt, i));
+					break;
+				case SQLITE_TEXT:
+				{
+					auto data = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+					auto sz = size_t(m_bytes[i]);
+					auto at = m_text.size();
+					m_text.append(data, sz);
+					m_cells.emplace_back(std::string_view(m_text.data() + at, sz));
+					break;
+				}
+				default:
+					m_cells.emplace_back(std::string_view());
+					break;
+				}
+			}
+		}
+	};
+
+	std::string columnSql(const data::DbTableMetaData& table, int column)
+	{
+		return "`" + (column == 0 ? std::string("row_id") : escapeColumn(table.columns[column])) + "`";
+	}
+
+	bool isIntegerColumn(const data::DbTableMetaData& table, int column)
+	{
+		return column == 0 || !table.store->dictionaries[column].empty();
+	}
+
+	// row_id and the projected columns into columns, all of the table's when the projection is empty
+	void projectedColumns(const data::DbTableMetaData& table, const data::Projection& projection, std::vector<int>& columns)
+	{
+		columns.clear();
+		columns.push_back(0);
+		if (projection.empty())
+		{
+			for (int i = 1; i < int(table.columns.size()); ++i)
+				columns.push_back(i);
+			return;
+		}
+		for (auto column : projection)
+		{
+			if (column > columns.back() && column < int(table.columns.size()))
+				columns.push_back(column);
+		}
+	}
+
+	// Arrow types of the columns as narrowed while loading, so each batch of the file agrees. Text columns with a
+	// dictionary are written as codes into it.
+	std::vector<data::ArrowColumn> arrowColumns(const data::DbTableMetaData& table, const std::vector<int>& columns)
+	{
+		std::vector<data::ArrowColumn> ret;
+		for (auto column : columns)
+		{
+			const auto& dict = table.store->dictionaries[column];
+			auto type = column == 0 ? data::ArrowType::Int64 : table.store->types[column];
+			// a code per row beats the values repeated
+			if (type == data::ArrowType::Utf8 && !dict.empty())
+				type = data::ArrowType::Dictionary;
+			ret.push_back({ table.columns[column], type, dict.empty() ? nullptr : &dict });
+		}
+		return ret;
+	}
+
+	// SELECT of the columns, then the sort keys again so seek keys are read from the row wherever the projection leaves them
+	std::string selectClause(const data::DbTableMetaData& table, const std::vector<int>& columns, const data::SortSpec& sort)
+	{
+		std::stringstream ss;
+		ss << "SELECT ";
+		for (size_t i = 0; i < columns.size(); ++i)
+		{
+			ss << (i ? ", " : "") << columnSql(table, columns[i]);
+		}
+		for (const auto& key : sort)
+		{
+			ss << ", " << columnSql(table, key.column);
+		}
+		ss << " FROM `" << table.store->name << "`";
+		return ss.str();
+	}
+
+	std::string orderClause(const data::DbTableMetaData& table, const data::SortSpec& sort)
+	{
+		std::stringstream ss;
+		ss << " ORDER BY ";
+		for (const auto& key : sort)
+		{
+			ss << columnSql(table, key.column) << (key.descending ? " DESC, " : " ASC, ");
+		}
+		ss << "row_id ASC";
+		return ss.str();
+	}
+
+	// (k1, k2, .., row_id) strictly after ?1, ?2, .., ?n+1 in the sort order, with per key directions.
+	// The leading bound on k1 lets an index on the order seek instead of scanning up to the position.
+	std::string seekClause(const data::DbTableMetaData& table, const data::SortSpec& sort, size_t key = 0)
+	{
+		std::stringstream ss;
+		if (key == 0 && !sort.empty())
+		{
+			ss << columnSql(table, sort[0].column) << (sort[0].descending ? " <= ?1" : " >= ?1") << " AND ";
+		}
+		if (key == sort.size())
+		{
+			ss << "row_id > ?" << key + 1;
+			return ss.str();
+		}
+
+		auto col = columnSql(table, sort[key].column);
+		ss << "(" << col << (sort[key].descending ? " < ?" : " > ?") << key + 1
+			<< " OR (" << col << " = ?" << key + 1 << " AND " << seekClause(table, sort, key + 1) << "))";
+		return ss.str();
+	}
+
+	void bindSeek(sqlite3_stmt* stmt, const data::SeekKey& seek)
+	{
+		int param = 1;
+		for (const auto& val : seek.values)
+		{
+			if (std::holds_alternative<int64_t>(val))
+				sqlite3_bind_int64(stmt, param++, std::get<int64_t>(val));
+			else
+				sqlite3_bind_text(stmt, param++, std::get<std::string>(val).c_str(), int(std::get<std::string>(val).size()), SQLITE_TRANSIENT);
+		}
+		sqlite3_bind_int64(stmt, param, seek.row_id);
+	}
+
+	// Reads the seek key of the current row of a statement from selectClause, its keys start at result column keys
+	data::SeekKey readSeek(sqlite3_stmt* stmt, const data::DbTableMetaData& table, const data::SortSpec& sort, int keys)
+	{
+		data::SeekKey ret;
+		ret.values.reserve(sort.size());
+		for (const auto& key : sort)
+		{
+			const auto at = keys++;
+			if (isIntegerColumn(table, key.column))
+			{
+				ret.values.emplace_back(int64_t(sqlite3_column_int64(stmt, at)));
+			}
+			else
+			{
+				auto data = reinterpret_cast<const char*>(sqlite3_column_text(stmt, at));
+				ret.values.emplace_back(std::string(data ? data : "", size_t(sqlite3_column_bytes(stmt, at))));
+			}
+		}
+		ret.row_id = sqlite3_column_int64(stmt, 0);
+		return ret;
+	}
+
+	// shorter searches can't use the trigram index
+	constexpr size_t searchMinChars = 3;
+
+	size_t utf8Length(std::string_view text)
+	{
+		return size_t(std::count_if(text.begin(), text.end(), [](char c) { return (static_cast<unsigned char>(c) & 0xC0) != 0x80; }));
+	}
+
+	// number(x) in sql: x when it holds a number or is text ParseNumber reads as one, null for anything else, so
+	// 'N/A' or '12abc' are left out of numeric comparisons and aggregates rather than read as 0 and 12
+	void sqlNumber(sqlite3_context* context, int, sqlite3_value** args)
+	{
+		switch (sqlite3_value_type(args[0]))
+		{
+		case SQLITE_INTEGER:
+		case SQLITE_FLOAT:
+			sqlite3_result_value(context, args[0]);
+			return;
+		case SQLITE_TEXT:
+		{
+			auto data = reinterpret_cast<const char*>(sqlite3_value_text(args[0]));
+			double value = 0;
+			if (data::ParseNumber(std::string_view(data, size_t(sqlite3_value_bytes(args[0]))), value))
+			{
+				sqlite3_result_double(context, value);
+				return;
+			}
+			break;
+		}
+		}
+		sqlite3_result_null(context);
+	}
+
+	bool numericRange(const data::ColumnFilter& filter, double& lower, double& upper)
+	{
+		auto parse = [](const std::string& text, double& out, double open)
+			{
+				if (text.empty())
+				{
+					out = open;
+					return true;
+				}
+				return data::ParseNumber(text, out);
+			};
+		return filter.op == data::FilterOp::Range && (!filter.value.empty() || !filter.upper.empty())
+			&& parse(filter.value, lower, -HUGE_VAL) && parse(filter.upper, upper, HUGE_VAL);
+	}
+
+	// the smallest text greater than everything starting with prefix, empty when there is none
+	std::string prefixEnd(std::string prefix)
+	{
+		while (!prefix.empty() && static_cast<unsigned char>(prefix.back()) == 0xFF)
+			prefix.pop_back();
+		if (!prefix.empty())
+			prefix.back() = char(static_cast<unsigned char>(prefix.back()) + 1);
+		return prefix;
+	}
+
+	// folds like sqlite's LIKE and lower() do, ASCII letters only, so MATCH and the LIKE scan agree on every row
+	std::string asciiLower(std::string text)
+	{
+		for (auto& c : text)
+		{
+			if (c >= 'A' && c <= 'Z')
+				c = char(c - 'A' + 'a');
+		}
+		return text;
+	}
+
+	std::string likeContains(const std::string& text)
+	{
+		std::string like = "%";
+		for (char c : text)
+		{
+			if (c == '%' || c == '_' || c == '\\')
+				like.push_back('\\');
+			like.push_back(c);
+		}
+		like.push_back('%');
+		return like;
+	}
+
+	// WHERE condition for filter, empty when it matches every row. Binds with bindFilter.
+	std::string filterClause(const data::DbTableMetaData& table, const data::RowFilter& filter)
+	{
+		std::vector<std::string> conditions;
+		const auto& dictionaries = table.store->dictionaries;
+
+		// dictionary columns are matched through their value tables, codes are assigned in value order
+		auto dictionarySql = [&](int column)
+			{
+				return "(SELECT code FROM `" + dictionaryTable(table.store->name, size_t(column)) + "` WHERE value ";
+			};
+
+		if (!filter.search.empty())
+		{
+			std::stringstream ss;
+			auto index = table.store->SearchIndex();
+			if (!index.empty() && utf8Length(filter.search) >= searchMinChars)
+			{
+				ss << "row_id IN (SELECT rowid FROM `" << index << "` WHERE `" << index << "` MATCH :search)";
+			}
+			else
+			{
+				// scans until the index is built
+				bool first = true;
+				for (size_t i = 1; i < table.columns.size(); ++i)
+				{
+					if (!dictionaries[i].empty())
+						continue;
+					ss << (first ? "" : " OR ") << columnSql(table, int(i)) << " LIKE :like ESCAPE '\\'";
+					first = false;
+				}
+				if (first)
+					ss << "0";
+			}
+
+			for (size_t i = 1; i < table.columns.size(); ++i)
+			{
+				if (!dictionaries[i].empty())
+					ss << " OR " << columnSql(table, int(i)) << " IN " << dictionarySql(int(i)) << "LIKE :like ESCAPE '\\')";
+			}
+			conditions.push_back(ss.str());
+		}
+
+		for (size_t k = 0; k < filter.columns.size(); ++k)
+		{
+			const auto& cf = filter.columns[k];
+			if (cf.column <= 0 || cf.column >= int(table.columns.size()))
+				continue;
+
+			const auto col = columnSql(table, cf.column);
+			const bool dict = !dictionaries[cf.column].empty();
+			const auto param = ":f" + std::to_string(k);
+
+			double lower = 0, upper = 0;
+			std::stringstream ss;
+			switch (cf.op)
+			{
+			case data::FilterOp::Equals:
+			case data::FilterOp::Prefix:
+			case data::FilterOp::Range:
+				if (numericRange(cf, lower, upper))
+				{
+					if (dict)
+						ss << col << " IN " << dictionarySql(cf.column) << "IS NOT NULL AND number(value) BETWEEN " << param << " AND " << param << "b)";
+					else
+						ss << "number(" << col << ") BETWEEN " << param << " AND " << param << "b";
+				}
+				else if (dict)
+					ss << col << " >= " << param << " AND " << col << " < " << param << "b";
+				else if (cf.op == data::FilterOp::Equals)
+					ss << col << " = " << param;
+				else if (cf.op == data::FilterOp::Prefix)
+					ss << col << " >= " << param << " AND " << col << " < " << param << "b";
+				else
+					ss << col << " >= " << param << " AND " << col << " <= " << param << "b";
+				break;
+			case data::FilterOp::Contains:
+				if (dict)
+					ss << col << " IN " << dictionarySql(cf.column) << "LIKE " << param << " ESCAPE '\\')";
+				else
+					ss << col << " LIKE " << param << " ESCAPE '\\'";
+				break;
+			case data::FilterOp::Empty:
+				if (dict)
+					ss << "(" << col << " IS NULL OR " << col << " IN " << dictionarySql(cf.column) << "= ''))";
+				else
+					ss << "(" << col << " IS NULL OR " << col << " = '')";
+				break;
+			}
+			conditions.push_back(ss.str());
+		}
+
+		std::string ret;
+		for (const auto& condition : conditions)
+		{
+			ret.append(ret.empty() ? "(" : " AND (").append(condition).append(")");
+		}
+		return ret;
+	}
+
+	void bindFilter(sqlite3_stmt* stmt, const data::DbTableMetaData& table, const data::RowFilter& filter)
+	{
+		auto bindText = [&](const std::string& name, const std::string& text)
+			{
+				if (auto param = sqlite3_bind_parameter_index(stmt, name.c_str()))
+					sqlite3_bind_text(stmt, param, text.c_str(), int(text.size()), SQLITE_TRANSIENT);
+			};
+
+		if (!filter.search.empty())
+		{
+			// one FTS5 string, matching the search as a substring with the trigram tokenizer. The index holds the
+			// values folded by lower() and is case sensitive itself, its own folding would also fold non-ASCII text.
+			std::string quoted = "\"";
+			for (char c : asciiLower(filter.search))
+				quoted.append(c == '"' ? "\"\"" : std::string(1, c));
+			quoted.append("\"");
+			bindText(":search", quoted);
+			bindText(":like", likeContains(filter.search));
+		}
+
+		const auto& dictionaries = table.store->dictionaries;
+		for (size_t k = 0; k < filter.columns.size(); ++k)
+		{
+			const auto& cf = filter.columns[k];
+			if (cf.column <= 0 || cf.column >= int(table.columns.size()))
+				continue;
+
+			const auto param = ":f" + std::to_string(k);
+			const auto first = sqlite3_bind_parameter_index(stmt, param.c_str());
+			const auto second = sqlite3_bind_parameter_index(stmt, (param + "b").c_str());
+
+			double lower = 0, upper = 0;
+			if (numericRange(cf, lower, upper))
+			{
+				sqlite3_bind_double(stmt, first, lower);
+				sqlite3_bind_double(stmt, second, upper);
+				continue;
+			}
+
+			const auto& dict = dictionaries[cf.column];
+			if (!dict.empty() && cf.op != data::FilterOp::Contains && cf.op != data::FilterOp::Empty)
+			{
+				// the codes of the matching values are one range
+				size_t from = 0, to = dict.size();
+				if (cf.op == data::FilterOp::Equals)
+				{
+					from = size_t(std::lower_bound(dict.begin(), dict.end(), cf.value) - dict.begin());
+					to = size_t(std::upper_bound(dict.begin(), dict.end(), cf.value) - dict.begin());
+				}
+				else if (cf.op == data::FilterOp::Prefix)
+				{
+					const auto end = prefixEnd(cf.value);
+					from = size_t(std::lower_bound(dict.begin(), dict.end(), cf.value) - dict.begin());
+					to = end.empty() ? dict.size() : size_t(std::lower_bound(dict.begin(), dict.end(), end) - dict.begin());
+				}
+				else
+				{
+					from = size_t(std::lower_bound(dict.begin(), dict.end(), cf.value) - dict.begin());
+					if (!cf.upper.empty())
+						to = size_t(std::upper_bound(dict.begin(), dict.end(), cf.upper) - dict.begin());
+				}
+				sqlite3_bind_int64(stmt, first, int64_t(from));
+				sqlite3_bind_int64(stmt, second, int64_t(std::max(from, to)));
+				continue;
+			}
+
+			switch (cf.op)
+			{
+			case data::FilterOp::Equals:
+				sqlite3_bind_text(stmt, first, cf.value.c_str(), int(cf.value.size()), SQLITE_TRANSIENT);
+				break;
+			case data::FilterOp::Prefix:
+			{
+				// past the last prefix a blob bound is above all text
+				const auto end = prefixEnd(cf.value);
+				sqlite3_bind_text(stmt, first, cf.value.c_str(), int(cf.value.size()), SQLITE_TRANSIENT);
+				if (end.empty())
+					sqlite3_bind_zeroblob(stmt, second, 0);
+				else
+					sqlite3_bind_text(stmt, second, end.c_str(), int(end.size()), SQLITE_TRANSIENT);
+				break;
+			}
+			case data::FilterOp::Range:
+				sqlite3_bind_text(stmt, first, cf.value.c_str(), int(cf.value.size()), SQLITE_TRANSIENT);
+				if (cf.upper.empty())
+					sqlite3_bind_zeroblob(stmt, second, 0);
+				else
+					sqlite3_bind_text(stmt, second, cf.upper.c_str(), int(cf.upper.size()), SQLITE_TRANSIENT);
+				break;
+			case data::FilterOp::Contains:
+			{
+				const auto like = likeContains(cf.value);
+				sqlite3_bind_text(stmt, first, like.c_str(), int(like.size()), SQLITE_TRANSIENT);
+				break;
+			}
+			case data::FilterOp::Empty:
+				break;
+			}
+		}
+	}
+
+	// Identifies the rows a filter selects, whichever statement is used to find them
+	std::string filterValues(const data::RowFilter& filter)
+	{
+		std::stringstream ss;
+		ss << filter.search.size() << ":" << filter.search;
+		for (const auto& cf : filter.columns)
+		{
+			ss << "\n" << cf.column << " " << int(cf.op) << " " << cf.value.size() << ":" << cf.value << cf.upper.size() << ":" << cf.upper;
+		}
+		return ss.str();
+	}
+
+	// Identifies what a filter selects and how, for state kept per filtered view
+	std::string filterKey(const data::DbTableMetaData& table, const data::RowFilter& filter)
+	{
+		return filterClause(table, filter) + "\n" + filterValues(filter);
+	}
+
+	// Identifies a group by on a table, with the filter as filterKey does
+	std::string groupKey(const data::DbTableMetaData& table, const data::GroupBySpec& spec)
+	{
+		std::stringstream ss;
+		for (auto key : spec.keys)
+		{
+			ss << key << " ";
+		}
+		ss << "|";
+		for (const auto& aggregate : spec.aggregates)
+		{
+			ss << " " << int(aggregate.op) << ":" << aggregate.column;
+		}
+		ss << "\n" << filterKey(table, spec.filter);
+		return ss.str();
+	}
+
+	// Streaming 64 bit content hash, 4 independent lanes over 32 byte blocks so it runs near read speed.
+	// Not cryptographic, only used to spot byte identical files.
+	class ContentHasher
+	{
+		static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+		static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+
+		uint64_t lanes[4] = { prime1, prime2, ~prime1, ~prime2 };
+		unsigned char tail[32] = {};
+		size_t tailSize = 0;
+		uint64_t total = 0;
+
+		static uint64_t round(uint64_t acc, uint64_t v)
+		{
+			acc += v * prime2;
+			acc = (acc << 31) | (acc >> 33);
+			return acc * prime1;
+		}
+
+		void block(const unsigned char* p)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				uint64_t v;
+				memcpy(&v, p + i * 8, sizeof(v));
+				lanes[i] = round(lanes[i], v);
+			}
+		}
+
+	public:
+		void Update(const char* data, size_t len)
+		{
+			auto p = reinterpret_cast<const unsigned char*>(data);
+			total += len;
+
+			if (tailSize)
+			{
+				auto take = std::min(len, sizeof(tail) - tailSize);
+				memcpy(tail + tailSize, p, take);
+				tailSize += take;
+				p += take;
+				len -= take;
+				if (tailSize < sizeof(tail))
+					return;
+				block(tail);
+				tailSize = 0;
+			}
+
+			for (; len >= sizeof(tail); p += sizeof(tail), len -= sizeof(tail))
+				block(p);
+
+			memcpy(tail, p, len);
+			tailSize = len;
+		}
+
+		uint64_t Final() const
+		{
+			uint64_t h = total * prime1;
+			for (auto lane : lanes)
+				h = round(h ^ lane, lane);
+			for (size_t i = 0; i < tailSize; ++i)
+				h = round(h, tail[i]);
+			h ^= h >> 29;
+			h *= prime2;
+			h ^= h >> 32;
+			return h;
+		}
+	};
+
+	struct FileStamp
+	{
+		uint64_t size;
+		int64_t modified;
+		data::Fingerprint fingerprint;
+	};
+
+	// Everything loaded by any data set in the process, so equal content is only ever held once. Entries are weak,
+	// the ones whose data set or store is gone are swept out as others are added.
+	std::mutex s_registryLock;
+	std::unordered_map<std::string, FileStamp> s_stamps;
+	std::map<std::tuple<uint64_t, uint64_t>, std::weak_ptr<data::TableStore>> s_stores;
+	std::unordered_map<std::string, std::weak_ptr<data::DbDataSet>> s_datasets;
+
+	std::atomic<size_t> s_memoryBudget = size_t(4) << 30;
+	std::atomic<uint64_t> s_storeFiles = 0;
+	const uint64_t s_session = (uint64_t(std::random_device{}()) << 32) | std::random_device{}();
+
+	// tables below this sort fast enough without an index
+	constexpr size_t indexMinRows = 16384;
+	// how long a build waits for readers to let go before giving up
+	constexpr int indexBusyMs = 30000;
+	constexpr int storeJobAttempts = 3;
+	// a memdb is locked for readers while a build writes it, they give up after this and read again later
+	constexpr int readBusyMs = 1000;
+	constexpr int busyStepMs = 5;
+
+	bool overBudget()
+	{
+		return s_memoryBudget && size_t(sqlite3_memory_used()) > s_memoryBudget;
+	}
+
+	std::filesystem::path tempStoreFile()
+	{
+		std::stringstream ss;
+		ss << "gui4life_" << std::hex << s_session << "_" << std::dec << s_storeFiles++ << ".db";
+		return std::filesystem::temp_directory_path() / ss.str();
+	}
+
+	// with the WAL files a read only connection closing last leaves behind
+	void removeStoreFile(const std::filesystem::path& path)
+	{
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+		std::filesystem::remove(path.string() + "-wal", ec);
+		std::filesystem::remove(path.string() + "-shm", ec);
+	}
+
+	// Temp file backed database tuned for reading: nothing to recover so no journal or syncs,
+	// a page cache sized from the budget and the file memory mapped
+	sqlite3* openDiskStore(const std::filesystem::path& path)
+	{
+		sqlite3* db = nullptr;
+		auto rc = sqlite3_open(path.string().c_str(), &db);
+		if (rc)
+		{
+			sqlite3_close(db);
+			throw new data::failed_db_create();
+		}
+
+		std::stringstream ss;
+		ss << "PRAGMA journal_mode = OFF;";
+		ss << "PRAGMA synchronous = OFF;";
+		ss << "PRAGMA cache_size = -" << std::max<size_t>(s_memoryBudget.load() / 8 / 1024, 16 * 1024) << ";";
+		ss << "PRAGMA mmap_size = " << (size_t(1) << 32) << ";";
+		sqlite3_exec(db, ss.str().c_str(), nullptr, nullptr, nullptr);
+		sqlite3_busy_timeout(db, readBusyMs);
+
+		return db;
+	}
+
+	// In memory database other connections of this process can open through the memdb VFS
+	sqlite3* openMemoryStore(std::string& uri)
+	{
+		std::stringstream ss;
+		ss << "file:/gui4life_" << std::hex << s_session << "_" << std::dec << s_storeFiles++ << "?vfs=memdb";
+		uri = ss.str();
+
+		sqlite3* db = nullptr;
+		auto rc = sqlite3_open_v2(uri.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, nullptr);
+		if (rc)
+		{
+			sqlite3_close(db);
+			throw new data::failed_db_create();
+		}
+
+		// memdb stops growing at 1GB unless told otherwise, the memory budget is what limits it here
+		sqlite3_int64 limit = sqlite3_int64(1) << 46;
+		sqlite3_file_control(db, "main", SQLITE_FCNTL_SIZE_LIMIT, &limit);
+
+		return db;
+	}
+
+	// Read only connection to an existing store, null when it can't be opened
+	sqlite3* openReader(const std::string& uri, bool disk)
+	{
+		sqlite3* db = nullptr;
+		// a reader is used by one thread at a time, so sqlite's own locking of every call is left out
+		if (sqlite3_open_v2(uri.c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+		{
+			sqlite3_close(db);
+			return nullptr;
+		}
+		sqlite3_create_function(db, "number", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, &sqlNumber, nullptr, nullptr);
+
+		if (disk)
+		{
+			std::stringstream ss;
+			ss << "PRAGMA cache_size = -" << std::max<size_t>(s_memoryBudget.load() / 8 / 1024, 16 * 1024) << ";";
+			ss << "PRAGMA mmap_size = " << (size_t(1) << 32) << ";";
+			sqlite3_exec(db, ss.str().c_str(), nullptr, nullptr, nullptr);
+		}
+
+		return db;
+	}
+
+	int64_t pragmaInt(sqlite3* db, const char* sql)
+	{
+		sqlite3_stmt* stmt = nullptr;
+		int64_t ret = 0;
+		if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW)
+			ret = sqlite3_column_int64(stmt, 0);
+		sqlite3_finalize(stmt);
+		return ret;
+	}
+
+	// The database a store job works in. Readers get a connection of their own to the store, writers build in the
+	// store's own connection. A disk store is in WAL mode by then, so its readers keep the snapshot they started with.
+	// A memdb is locked for readers while it's written, they wait out the build up to their busy timeout and read again.
+	class JobConnection
+	{
+	private:
+		sqlite3* m_db = nullptr;
+		bool m_own = false;
+
+	public:
+		JobConnection(data::TableStore& store, bool write)
+		{
+			if (write)
+			{
+				m_db = store.db;
+				sqlite3_busy_timeout(m_db, indexBusyMs);
+				return;
+			}
+
+			const auto location = store.Location();
+			m_db = openReader(location.uri, location.tier == data::StorageTier::Disk);
+			m_own = true;
+			if (m_db)
+				sqlite3_busy_timeout(m_db, readBusyMs);
+		}
+
+		~JobConnection()
+		{
+			if (m_own)
+				sqlite3_close(m_db);
+		}
+
+		JobConnection(const JobConnection&) = delete;
+		JobConnection& operator=(const JobConnection&) = delete;
+
+		// null when no connection could be opened
+		sqlite3* Db() const { return m_db; }
+	};
+
+	// Background work on stores, index builds and sort permutations for every store in the process.
+	// One job at a time on its own thread, so builds never write a store at the same time.
+	class StoreWorker
+	{
+	public:
+		// gets a null Db() when no connection could be opened, SQLITE_BUSY is tried again unless it was the last attempt
+		using fnJob = std::function<int(data::TableStore& store, JobConnection& connection, bool lastAttempt)>;
+
+	private:
+		struct Job
+		{
+			std::weak_ptr<data::TableStore> store;
+			bool write = false;
+			fnJob run;
+			int attempts = 0;
+		};
+
+		std::mutex m_lock;
+		std::condition_variable m_wake;
+		std::deque<Job> m_jobs;
+		std::thread m_worker;
+		bool m_stopping = false;
+		sqlite3* m_running = nullptr;
+
+		void run()
+		{
+			for (;;)
+			{
+				Job job;
+				{
+					std::unique_lock lock(m_lock);
+					m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+					if (m_stopping)
+						return;
+					job = std::move(m_jobs.front());
+					m_jobs.pop_front();
+				}
+
+				auto store = job.store.lock();
+				if (!store)
+					continue;
+
+				const bool last = job.attempts + 1 >= storeJobAttempts;
+				int rc = SQLITE_OK;
+				{
+					JobConnection connection(*store, job.write);
+					if (!connection.Db())
+					{
+						job.run(*store, connection, true);
+						continue;
+					}
+
+					{
+						std::lock_guard lock(m_lock);
+						m_running = connection.Db();
+					}
+
+					rc = job.run(*store, connection, last);
+
+					std::lock_guard lock(m_lock);
+					m_running = nullptr;
+				}
+
+				// a long read held the store past the busy timeout, go again after the other jobs
+				if (rc == SQLITE_BUSY && !last)
+				{
+					std::lock_guard lock(m_lock);
+					job.attempts++;
+					if (!m_stopping)
+						m_jobs.push_back(std::move(job));
+				}
+			}
+		}
+
+	public:
+		~StoreWorker()
+		{
+			{
+				std::lock_guard lock(m_lock);
+				m_stopping = true;
+				m_jobs.clear();
+				if (m_running)
+					sqlite3_interrupt(m_running);
+			}
+			m_wake.notify_one();
+			if (m_worker.joinable())
+				m_worker.join();
+		}
+
+		void Add(const std::shared_ptr<data::TableStore>& store, bool write, fnJob run)
+		{
+			std::lock_guard lock(m_lock);
+			if (!m_worker.joinable())
+				m_worker = std::thread(&StoreWorker::run, this);
+			m_jobs.push_back(Job{ store, write, std::move(run) });
+			m_wake.notify_one();
+		}
+	};
+
+	// Row ids of a table in the order of a sort spec whose first key is ascending. The same spec with every
+	// direction flipped reads it backwards, ties marks rows equal to the one before so those keep row_id order.
+	struct Permutation
+	{
+		std::vector<uint32_t> rows;
+		std::vector<uint64_t> ties;
+
+		bool Tie(size_t i) const { return (ties[i / 64] >> (i % 64)) & 1; }
+
+		size_t Bytes() const { return rows.size() * sizeof(uint32_t) + ties.size() * sizeof(uint64_t); }
+
+		void Slice(size_t offset, size_t count, bool reversed, std::vector<uint32_t>& out) const
+		{
+			out.clear();
+			const size_t n = rows.size();
+			const size_t end = std::min(n, offset + count);
+			if (!reversed)
+			{
+				out.assign(rows.begin() + std::min(offset, n), rows.begin() + end);
+				return;
+			}
+
+			for (size_t p = offset; p < end;)
+			{
+				// the run of equal rows holding position p, walked whole words at a time where they are all ties
+				size_t first = n - 1 - p;
+				while (Tie(first))
+				{
+					if (first % 64 == 63 && ties[first / 64] == ~uint64_t(0))
+						first -= 64;
+					else
+						first--;
+				}
+				size_t last = n - 1 - p;
+				while (last + 1 < n && Tie(last + 1))
+				{
+					if ((last + 1) % 64 == 0 && last + 64 < n && ties[(last + 1) / 64] == ~uint64_t(0))
+						last += 64;
+					else
+						last++;
+				}
+
+				// reversed the run starts at n - 1 - last and keeps its ascending row ids
+				const size_t runStart = n - 1 - last;
+				const size_t runEnd = std::min(end, n - first);
+				for (; p < runEnd; ++p)
+				{
+					out.push_back(rows[first + (p - runStart)]);
+				}
+			}
+		}
+	};
+
+	// Permutations by store and spec, least recently used ones dropped past a share of the memory budget
+	class PermutationCache
+	{
+		struct Entry
+		{
+			std::weak_ptr<data::TableStore> store;
+			const data::TableStore* key = nullptr;
+			data::SortSpec spec;
+			// null while building or after a failed build
+			std::shared_ptr<const Permutation> permutation;
+			bool failed = false;
+		};
+
+		std::mutex m_lock;
+		std::list<Entry> m_lru;
+		size_t m_bytes = 0;
+
+		std::list<Entry>::iterator find(const data::TableStore* store, const data::SortSpec& spec)
+		{
+			return std::find_if(m_lru.begin(), m_lru.end(), [&](const Entry& entry)
+				{
+					return entry.key == store && entry.spec == spec && !entry.store.expired();
+				});
+		}
+
+		size_t budget() const
+		{
+			return std::max<size_t>(s_memoryBudget.load() / 8, size_t(64) << 20);
+		}
+
+	public:
+		// ready permutation for the normalized spec
+		std::shared_ptr<const Permutation> Find(const data::TableStore* store, const data::SortSpec& spec)
+		{
+			std::lock_guard lock(m_lock);
+			auto found = find(store, spec);
+			if (found == m_lru.end() || !found->permutation)
+				return nullptr;
+			m_lru.splice(m_lru.begin(), m_lru, found);
+			return found->permutation;
+		}
+
+		// true when nothing is built or building for spec yet, the caller then queues the build
+		bool Claim(const std::shared_ptr<data::TableStore>& store, const data::SortSpec& spec)
+		{
+			std::lock_guard lock(m_lock);
+			if (find(store.get(), spec) != m_lru.end())
+				return false;
+			m_lru.push_back(Entry{ store, store.get(), spec, nullptr });
+			return true;
+		}
+
+		void Put(const data::TableStore* store, const data::SortSpec& spec, std::shared_ptr<const Permutation> permutation)
+		{
+			std::lock_guard lock(m_lock);
+			auto found = find(store, spec);
+			if (found == m_lru.end())
+				return;
+
+			m_bytes += permutation->Bytes();
+			found->permutation = std::move(permutation);
+			m_lru.splice(m_lru.begin(), m_lru, found);
+
+			for (auto it = m_lru.begin(); it != m_lru.end();)
+			{
+				if (it->store.expired())
+				{
+					m_bytes -= it->permutation ? it->permutation->Bytes() : 0;
+					it = m_lru.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+
+			// least recently used first, never the one just built nor builds in flight
+			for (auto it = std::prev(m_lru.end()); m_bytes > budget() && it != m_lru.begin();)
+			{
+				auto prev = std::prev(it);
+				if (it->permutation)
+				{
+					m_bytes -= it->permutation->Bytes();
+					m_lru.erase(it);
+				}
+				it = prev;
+			}
+		}
+
+		// keeps the claim so a failing build isn't queued again for every page
+		void Failed(const data::TableStore* store, const data::SortSpec& spec)
+		{
+			std::lock_guard lock(m_lock);
+			auto found = find(store, spec);
+			if (found != m_lru.end())
+				found->failed = true;
+		}
+
+		bool HasFailed(const data::TableStore* store, const data::SortSpec& spec)
+		{
+			std::lock_guard lock(m_lock);
+			auto found = find(store, spec);
+			return found != m_lru.end() && found->failed;
+		}
+
+		data::PermutationStats Stats(const data::TableStore* store)
+		{
+			std::lock_guard lock(m_lock);
+			data::PermutationStats ret;
+			for (const auto& entry : m_lru)
+			{
+				if (entry.key == store && entry.permutation && !entry.store.expired())
+				{
+					ret.count++;
+					ret.bytes += entry.permutation->Bytes();
+				}
+			}
+			return ret;
+		}
+	};
+
+	PermutationCache s_permutations;
+	// after the cache, so it stops before the cache its jobs write to is destroyed
+	StoreWorker s_storeWorker;
+
+	// spec with its first key ascending, reversed when that flipped every direction
+	data::SortSpec normalizedSort(const data::SortSpec& sort, bool& reversed)
+	{
+		reversed = !sort.empty() && sort[0].descending;
+		auto ret = sort;
+		if (reversed)
+		{
+			for (auto& key : ret)
+				key.descending = !key.descending;
+		}
+		return ret;
+	}
+
+	// True when the key columns of the current row of a SELECT row_id, k1, .. statement equal prev, which then holds them
+	bool sameKey(sqlite3_stmt* stmt, const data::DbTableMetaData& table, const data::SortSpec& sort, std::vector<data::KeyVal>& prev)
+	{
+		bool same = prev.size() == sort.size();
+		prev.resize(sort.size());
+		for (size_t i = 0; i < sort.size(); ++i)
+		{
+			const int col = int(i) + 1;
+			if (isIntegerColumn(table, sort[i].column))
+			{
+				const int64_t value = sqlite3_column_int64(stmt, col);
+				if (!same || !std::holds_alternative<int64_t>(prev[i]) || std::get<int64_t>(prev[i]) != value)
+				{
+					same = false;
+					prev[i] = value;
+				}
+				continue;
+			}
+
+			auto data = reinterpret_cast<const char*>(sqlite3_column_text(stmt, col));
+			const std::string_view value(data ? data : "", size_t(sqlite3_column_bytes(stmt, col)));
+			if (!same || !std::holds_alternative<std::string>(prev[i]) || std::get<std::string>(prev[i]) != value)
+			{
+				same = false;
+				prev[i] = std::string(value);
+			}
+		}
+		return same;
+	}
+
+	// Queues the sort of a whole table into a permutation unless one is built or building, sort is normalized.
+	// False when the sort gets none: the table is small enough to sort as is, too large for it or the build failed.
+	bool requestPermutation(const std::shared_ptr<data::TableStore>& store, const data::SortSpec& sort)
+	{
+		// row ids are kept in 32 bits
+		if (sort.empty() || sort[0].column == 0 || store->count < indexMinRows || store->count > UINT32_MAX)
+			return false;
+		if (!s_permutations.Claim(store, sort))
+			return !s_permutations.HasFailed(store.get(), sort);
+
+		s_storeWorker.Add(store, false, [sort](data::TableStore& store, JobConnection& connection, bool lastAttempt)
+			{
+				auto db = connection.Db();
+				data::DbTableMetaData table{};
+				table.columns = store.columns;
+				table.store = store.shared_from_this();
+
+				std::stringstream ss;
+				ss << "SELECT row_id";
+				for (const auto& key : sort)
+				{
+					ss << ", " << columnSql(table, key.column);
+				}
+				ss << " FROM `" << store.name << "`";
+				if (auto index = store.ReadyIndex(sort); !index.empty())
+				{
+					ss << " INDEXED BY `" << index << "`";
+				}
+				ss << orderClause(table, sort) << ";";
+				const auto sql = ss.str();
+
+				sqlite3_stmt* stmt = nullptr;
+				if (!db || sqlite3_prepare_v2(db, sql.c_str(), int(sql.size()), &stmt, nullptr) != SQLITE_OK)
+				{
+					sqlite3_finalize(stmt);
+					s_permutations.Failed(&store, sort);
+					return SQLITE_ERROR;
+				}
+
+				auto permutation = std::make_shared<Permutation>();
+				permutation->rows.reserve(store.count);
+				permutation->ties.reserve((store.count + 63) / 64);
+
+				std::vector<data::KeyVal> prev;
+				int rc = SQLITE_OK;
+				while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+				{
+					const size_t i = permutation->rows.size();
+					if (i % 64 == 0)
+						permutation->ties.push_back(0);
+					if (sameKey(stmt, table, sort, prev) && i)
+						permutation->ties.back() |= uint64_t(1) << (i % 64);
+					permutation->rows.push_back(uint32_t(sqlite3_column_int64(stmt, 0)));
+				}
+				sqlite3_finalize(stmt);
+
+				if (rc == SQLITE_DONE)
+					s_permutations.Put(&store, sort, std::move(permutation));
+				else if (rc != SQLITE_BUSY || lastAttempt)
+					s_permutations.Failed(&store, sort);
+				return rc;
+			});
+		return true;
+	}
+
+	std::filesystem::path canonicalPath(const std::string& path)
+	{
+		auto ret = std::filesystem::canonical(path);
+		if (!ret.has_filename() && ret != ret.root_path())
+			ret = ret.parent_path();
+		return ret;
+	}
+
+	std::vector<std::filesystem::path> matchingFiles(const std::filesystem::path& dir, const std::string& pattern)
+	{
+		std::vector<std::filesystem::path> ret;
+		for (auto const& item : std::filesystem::directory_iterator(dir))
+		{
+			if (item.is_regular_file() && item.path().filename().string().find(pattern) != std::string::npos)
+			{
+				ret.push_back(item.path());
+			}
+		}
+		std::sort(ret.begin(), ret.end());
+		return ret;
+	}
+
+	// Content fingerprint of a file, only rehashed when its size or write time changed since last seen
+	data::Fingerprint fingerprintFile(const std::filesystem::path& path)
+	{
+		auto key = path.string();
+		uint64_t size = std::filesystem::file_size(path);
+		int64_t modified = std::filesystem::last_write_time(path).time_since_epoch().count();
+
+		{
+			std::lock_guard lock(s_registryLock);
+			auto found = s_stamps.find(key);
+			if (found != s_stamps.end() && found->second.size == size && found->second.modified == modified)
+				return found->second.fingerprint;
+		}
+
+		std::ifstream in(key, std::ios::binary);
+		if (!in.is_open())
+		{
+			throw new data::file_not_found{ key };
+		}
+
+		ContentHasher hasher;
+		std::vector<char> buffer(1 << 20);
+		while (in)
+		{
+			in.read(buffer.data(), std::streamsize(buffer.size()));
+			hasher.Update(buffer.data(), size_t(in.gcount()));
+		}
+
+		data::Fingerprint ret{ size, hasher.Final() };
+
+		std::lock_guard lock(s_registryLock);
+		s_stamps[key] = FileStamp{ size, modified, ret };
+		return ret;
+	}
+
+	int64_t modifiedTime(const std::filesystem::path& path)
+	{
+		std::error_code error;
+		auto ret = std::filesystem::last_write_time(path, error);
+		return error ? -1 : int64_t(ret.time_since_epoch().count());
+	}
+
+	bool sameBytes(const std::filesystem::path& a, const std::filesystem::path& b)
+	{
+		std::ifstream left(a, std::ios::binary);
+		std::ifstream right(b, std::ios::binary);
+		if (!left.is_open() || !right.is_open())
+			return false;
+
+		std::vector<char> leftBuffer(1 << 20);
+		std::vector<char> rightBuffer(1 << 20);
+		while (left && right)
+		{
+			left.read(leftBuffer.data(), std::streamsize(leftBuffer.size()));
+			right.read(rightBuffer.data(), std::streamsize(rightBuffer.size()));
+			if (left.gcount() != right.gcount() || std::memcmp(leftBuffer.data(), rightBuffer.data(), size_t(left.gcount())) != 0)
+				return false;
+		}
+		return !left && !right;
+	}
+
+	// A fingerprint match is only a likely one, the store holds path's content once its source is untouched since
+	// it was read and path is that file or has the same bytes
+	bool holdsContentOf(const data::TableStore& store, const std::filesystem::path& path)
+	{
+		if (store.source.empty() || modifiedTime(store.source) != store.sourceModified)
+			return false;
+		std::error_code error;
+		if (std::filesystem::equivalent(store.source, path, error))
+			return true;
+		return sameBytes(store.source, path);
+	}
+
+	// Resolved location plus the content of every file it would load
+	std::string datasetIdentity(const std::filesystem::path& dir, const std::string& pattern)
+	{
+		std::stringstream ss;
+		ss << dir.string() << "|" << pattern;
+		for (const auto& file : matchingFiles(dir, pattern))
+		{
+			auto print = fingerprintFile(file);
+			ss << "|" << std::hex << print.size << ":" << print.hash;
+		}
+		return ss.str();
+	}
+
+}
+
+namespace data
+{
+
+	const char* StorageTierName(StorageTier tier)
+	{
+		switch (tier)
+		{
+		case StorageTier::Memory: return "memory";
+		case StorageTier::Disk: return "disk";
+		}
+		return "unknown";
+	}
+
+	void SetMemoryBudget(size_t bytes)
+	{
+		s_memoryBudget = bytes;
+	}
+
+	size_t GetMemoryBudget()
+	{
+		return s_memoryBudget;
+	}
+
+	void ForgetFingerprints()
+	{
+		std::lock_guard lock(s_registryLock);
+		s_stamps.clear();
+	}
+
+	TableStore::TableStore()
+	{
+		if (overBudget())
+		{
+			m_location.file = tempStoreFile();
+			db = openDiskStore(m_location.file);
+			m_location.uri = m_location.file.string();
+			m_location.tier = StorageTier::Disk;
+			return;
+		}
+
+		db = openMemoryStore(m_location.uri);
+		sqlite3_busy_timeout(db, readBusyMs);
+	}
+
+	TableStore::~TableStore()
+	{
+		assert(db);
+		sqlite3_close(db);
+
+		if (!m_location.file.empty())
+			removeStoreFile(m_location.file);
+	}
+
+	bool TableStore::SpillIfOverBudget()
+	{
+		if (m_location.tier != StorageTier::Memory || !overBudget())
+			return false;
+
+		auto path = tempStoreFile();
+		auto disk = openDiskStore(path);
+
+		auto backup = sqlite3_backup_init(disk, "main", db, "main");
+		if (!backup)
+		{
+			sqlite3_close(disk);
+			removeStoreFile(path);
+			throw new data::failed_db_create();
+		}
+		sqlite3_backup_step(backup, -1);
+		if (sqlite3_backup_finish(backup) != SQLITE_OK)
+		{
+			sqlite3_close(disk);
+			removeStoreFile(path);
+			throw new data::failed_db_create();
+		}
+
+		sqlite3_close(db);
+		db = disk;
+
+		std::lock_guard lock(m_locationLock);
+		m_location.file = path;
+		m_location.uri = path.string();
+		m_location.tier = StorageTier::Disk;
+		return true;
+	}
+
+	StoreLocation TableStore::Location() const
+	{
+		std::lock_guard lock(m_locationLock);
+		return m_location;
+	}
+
+#define LOG_TO(l, ...)        \
+	{                         \
+		std::stringstream ss; \
+		ss << __VA_ARGS__;    \
+        l(ss.str());          \
+	}
+
+	void TableStore::RequestIndex(const SortSpec& key)
+	{
+		// row_id first is the table's own order
+		if (key.empty() || key[0].column == 0 || count < indexMinRows)
+			return;
+
+		std::stringstream name;
+		std::stringstream sql;
+		name << "idx_" << this->name;
+		sql << " ON `" << this->name << "`(";
+		for (size_t i = 0; i < key.size(); ++i)
+		{
+			const auto column = key[i].column == 0 ? std::string("row_id") : escapeColumn(columns[key[i].column]);
+			name << "_" << key[i].column << (key[i].descending ? "d" : "a");
+			sql << (i ? ", `" : "`") << column << (key[i].descending ? "` DESC" : "` ASC");
+		}
+		sql << ");";
+
+		{
+			std::lock_guard lock(m_indexLock);
+			for (const auto& index : m_indexes)
+			{
+				if (index.key == key)
+					return;
+			}
+			m_indexes.push_back(IndexInfo{ name.str(), key });
+		}
+
+		s_storeWorker.Add(shared_from_this(), true, [index = name.str(), sql = "CREATE INDEX IF NOT EXISTS `" + name.str() + "`" + sql.str()](TableStore& store, JobConnection& connection, bool lastAttempt)
+			{
+				auto db = connection.Db();
+				if (!db)
+				{
+					store.IndexFinished(index, false, 0, 0);
+					return SQLITE_CANTOPEN;
+				}
+
+				// the index's size is what the database grew by, writes don't overlap
+				const auto pageSize = pragmaInt(db, "PRAGMA page_size;");
+				const auto pagesBefore = pragmaInt(db, "PRAGMA page_count;");
+
+				StopWatch build;
+				const auto rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+				const auto seconds = build.Seconds();
+
+				const auto pagesAfter = pragmaInt(db, "PRAGMA page_count;");
+
+				if (rc != SQLITE_BUSY || lastAttempt)
+					store.IndexFinished(index, rc == SQLITE_OK, seconds, uint64_t(std::max<int64_t>(0, pagesAfter - pagesBefore) * pageSize));
+				return rc;
+			});
+	}
+
+	std::string TableStore::ReadyIndex(const SortSpec& key) const
+	{
+		std::lock_guard lock(m_indexLock);
+		for (const auto& index : m_indexes)
+		{
+			if (index.key == key && index.ready && !index.search)
+				return index.name;
+		}
+		return {};
+	}
+
+	void TableStore::RequestSearch()
+	{
+		std::stringstream name;
+		std::stringstream sql;
+		name << "fts_" << this->name;
+
+		// contentless, the rows stay in the table and the index only maps trigrams to row ids
+		std::stringstream columnsSql;
+		std::stringstream valuesSql;
+		size_t indexed = 0;
+		for (size_t i = 1; i < columns.size(); ++i)
+		{
+			if (!dictionaries[i].empty())
+				continue;
+			columnsSql << ", c" << indexed++;
+			valuesSql << ", lower(`" << escapeColumn(columns[i]) << "`)";
+		}
+		if (!indexed)
+			return;
+
+		sql << "BEGIN;"
+			<< "CREATE VIRTUAL TABLE `" << name.str() << "` USING fts5(" << columnsSql.str().substr(2) << ", content='', tokenize='trigram case_sensitive 1');"
+			<< "INSERT INTO `" << name.str() << "`(rowid" << columnsSql.str() << ") SELECT row_id" << valuesSql.str() << " FROM `" << this->name << "`;"
+			<< "COMMIT;";
+
+		{
+			std::lock_guard lock(m_indexLock);
+			for (const auto& index : m_indexes)
+			{
+				if (index.search)
+					return;
+			}
+			IndexInfo info{ name.str(), {} };
+			info.search = true;
+			m_indexes.push_back(info);
+		}
+
+		s_storeWorker.Add(shared_from_this(), true, [index = name.str(), sql = sql.str()](TableStore& store, JobConnection& connection, bool lastAttempt)
+			{
+				auto db = connection.Db();
+				if (!db)
+				{
+					store.IndexFinished(index, false, 0, 0);
+					return SQLITE_CANTOPEN;
+				}
+
+				const auto pageSize = pragmaInt(db, "PRAGMA page_size;");
+				const auto pagesBefore = pragmaInt(db, "PRAGMA page_count;");
+
+				StopWatch build;
+				const auto rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+				const auto seconds = build.Seconds();
+				if (rc != SQLITE_OK)
+					sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+				const auto pagesAfter = pragmaInt(db, "PRAGMA page_count;");
+
+				if (rc != SQLITE_BUSY || lastAttempt)
+					store.IndexFinished(index, rc == SQLITE_OK, seconds, uint64_t(std::max<int64_t>(0, pagesAfter - pagesBefore) * pageSize));
+				return rc;
+			});
+	}
+
+	std::string TableStore::SearchIndex() const
+	{
+		std::lock_guard lock(m_indexLock);
+		for (const auto& index : m_indexes)
+		{
+			if (index.search && index.ready)
+				return index.name;
+		}
+		return {};
+	}
+
+	std::vector<IndexInfo> TableStore::GetIndexes() const
+	{
+		std::lock_guard lock(m_indexLock);
+		return m_indexes;
+	}
+
+	PermutationStats TableStore::GetPermutations() const
+	{
+		return s_permutations.Stats(this);
+	}
+
+	void TableStore::IndexFinished(const std::string& name, bool ok, double seconds, uint64_t bytes)
+	{
+		std::lock_guard lock(m_indexLock);
+		for (auto& index : m_indexes)
+		{
+			if (index.name == name)
+			{
+				index.ready = ok;
+				index.failed = !ok;
+				index.build_seconds = seconds;
+				index.bytes = bytes;
+			}
+		}
+	}
+
+	std::shared_ptr<DbDataSet> DbDataSet::Open(const std::string& path, const std::string& pattern, const fnLogger& logger)
+	{
+		if (!std::filesystem::exists(path))
+		{
+			LOG_TO(logger, "Couldn't find file " << path << "\n");
+			throw new folder_not_found();
+		}
+
+		auto identity = datasetIdentity(canonicalPath(path), pattern);
+
+		std::shared_ptr<DbDataSet> existing;
+		{
+			std::lock_guard lock(s_registryLock);
+			std::erase_if(s_datasets, [](const auto& entry) { return entry.second.expired(); });
+			auto found = s_datasets.find(identity);
+			if (found != s_datasets.end())
+				existing = found->second.lock();
+		}
+
+		if (existing)
+		{
+			const auto& tables = existing->m_meta.tables;
+			if (std::all_of(tables.begin(), tables.end(), [](const DbTableMetaData& table) { return table.store && holdsContentOf(*table.store, table.file_name); }))
+			{
+				LOG_TO(logger, path << " is already loaded as " << existing->m_path << "\n");
+				return existing;
+			}
+			LOG_TO(logger, path << " changed since it was loaded as " << existing->m_path << ", loading it again\n");
+		}
+
+		auto ret = std::make_shared<DbDataSet>();
+		ret->LoadFromPath(path, pattern, logger);
+
+		std::lock_guard lock(s_registryLock);
+		std::erase_if(s_datasets, [](const auto& entry) { return entry.second.expired(); });
+		s_datasets[ret->m_identity] = ret;
+		return ret;
+	}
+
+	const DbMetaData& DbDataSet::GetTableMetaData()
+	{
+		return m_meta;
+	}
+
+	int64_t DbDataSet::GetRowCount(const DbTableMetaData& table, const RowFilter& filter, const fnLogger& logger)
+	{
+		if (filter.empty())
+			return int64_t(table.count);
+
+		const auto key = filterValues(filter);
+		{
+			std::lock_guard lock(m_requestLock);
+			const auto& entry = countEntry(table, key);
+			if (entry.exact >= 0)
+				return entry.exact;
+		}
+
+		int64_t ret = -1;
+		{
+			std::lock_guard lock(m_lock);
+			ret = countRows(m_reader, table, filter, logger, 0, int64_t(table.count));
+		}
+
+		if (ret >= 0)
+		{
+			std::lock_guard lock(m_requestLock);
+			auto& entry = countEntry(table, key);
+			entry.exact = ret;
+		}
+		return ret;
+	}
+
+	RowCount DbDataSet::GetCount(const DbTableMetaData& table, const RowFilter& filter, const fnLogger& logger)
+	{
+		if (filter.empty())
+			return { int64_t(table.count), true };
+
+		const auto key = filterValues(filter);
+		const auto store = table.store.get();
+
+		std::lock_guard lock(m_requestLock);
+		auto& entry = countEntry(table, key);
+		if (entry.exact >= 0)
+			return { entry.exact, true };
+
+		if (!entry.queued && std::chrono::steady_clock::now() >= entry.retry)
+		{
+			// only the latest filter of a table is worth counting
+			std::erase_if(m_requests, [&](const PageRequest& request)
+				{
+					if (!request.count || request.table.store.get() != store)
+						return false;
+					auto found = m_counts.find({ store, filterValues(request.filter) });
+					if (found != m_counts.end())
+						found->second.queued = false;
+					return true;
+				});
+			if (m_countingStore == store && m_countingKey != key)
+			{
+				m_runningCancelled = true;
+				m_async.Interrupt();
+			}
+
+			if (!m_worker.joinable())
+			{
+				m_stopping = false;
+				m_worker = std::thread(&DbDataSet::runRequests, this);
+			}
+
+			m_requests.push_back(PageRequest{ nullptr, table, {}, filter, {}, logger, 0, 0, ++m_tickets, true });
+			entry.queued = true;
+			m_requestWake.notify_one();
+		}
+
+		return { entry.estimate, false };
+	}
+
+	DbDataSet::CountEntry& DbDataSet::countEntry(const DbTableMetaData& table, const std::string& key)
+	{
+		auto& ret = m_counts[{ table.store.get(), key }];
+		if (ret.store.lock() != table.store)
+			ret = CountEntry{ table.store };
+		ret.used = ++m_countUses;
+
+		// the least recently asked for goes, unless it's being counted
+		if (m_counts.size() > maxCountEntries)
+		{
+			auto oldest = m_counts.end();
+			for (auto it = m_counts.begin(); it != m_counts.end(); ++it)
+			{
+				if (!it->second.queued && (oldest == m_counts.end() || it->second.used < oldest->second.used))
+					oldest = it;
+			}
+			if (oldest != m_counts.end() && &oldest->second != &ret)
+				m_counts.erase(oldest);
+		}
+		return ret;
+	}
+
+	StatementCache::~StatementCache()
+	{
+		Invalidate();
+	}
+
+	sqlite3_stmt* StatementCache::Acquire(sqlite3* db, const std::string& sql)
+	{
+		std::string key(reinterpret_cast<const char*>(&db), sizeof(db));
+		key.append(sql);
+
+		auto found = m_index.find(key);
+		if (found != m_index.end())
+		{
+			m_stats.hits++;
+			m_lru.splice(m_lru.begin(), m_lru, found->second);
+			sqlite3_reset(found->second->stmt);
+			sqlite3_clear_bindings(found->second->stmt);
+			return found->second->stmt;
+		}
+
+		StopWatch prepare;
+
+		sqlite3_stmt* stmt = nullptr;
+		if (sqlite3_prepare_v3(db, sql.c_str(), int(sql.size()), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+		{
+			sqlite3_finalize(stmt);
+			return nullptr;
+		}
+
+		m_stats.misses++;
+		m_stats.prepare_seconds += prepare.Seconds();
+
+		m_lru.push_front(Entry{ db, sql, stmt });
+		m_index.emplace(std::move(key), m_lru.begin());
+
+		while (m_lru.size() > m_capacity)
+		{
+			auto& old = m_lru.back();
+			std::string oldKey(reinterpret_cast<const char*>(&old.db), sizeof(old.db));
+			oldKey.append(old.sql);
+			m_index.erase(oldKey);
+			sqlite3_finalize(old.stmt);
+			m_lru.pop_back();
+			m_stats.evictions++;
+		}
+
+		return stmt;
+	}
+
+	void StatementCache::Invalidate(sqlite3* db)
+	{
+		for (auto it = m_lru.begin(); it != m_lru.end();)
+		{
+			if (db && it->db != db)
+			{
+				++it;
+				continue;
+			}
+
+			std::string key(reinterpret_cast<const char*>(&it->db), sizeof(it->db));
+			key.append(it->sql);
+			m_index.erase(key);
+			sqlite3_finalize(it->stmt);
+			it = m_lru.erase(it);
+		}
+	}
+
+	ReadContext::~ReadContext()
+	{
+		Clear();
+	}
+
+	sqlite3* ReadContext::Connection(const TableStore& store)
+	{
+		const auto location = store.Location();
+
+		std::lock_guard lock(m_connectionLock);
+		auto& db = m_connections[&store];
+		if (!db)
+		{
+			db = openReader(location.uri, location.tier == StorageTier::Disk);
+			if (db)
+				sqlite3_busy_handler(db, &ReadContext::busyWait, this);
+		}
+		return db;
+	}
+
+	int ReadContext::busyWait(void* context, int count)
+	{
+		auto ctx = static_cast<ReadContext*>(context);
+		if (ctx->m_interrupted || count * busyStepMs >= readBusyMs)
+			return 0;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(busyStepMs));
+		return 1;
+	}
+
+	void ReadContext::Interrupt()
+	{
+		m_interrupted = true;
+
+		std::lock_guard lock(m_connectionLock);
+		for (const auto& [store, db] : m_connections)
+		{
+			if (db)
+				sqlite3_interrupt(db);
+		}
+	}
+
+	void ReadContext::Clear()
+	{
+		statements.Invalidate();
+		positions.clear();
+
+		std::lock_guard lock(m_connectionLock);
+		for (const auto& [store, db] : m_connections)
+		{
+			sqlite3_close(db);
+		}
+		m_connections.clear();
+	}
+
+	ResultQueue::~ResultQueue()
+	{
+		TakeAll();
+	}
+
+	void ResultQueue::Push(std::unique_ptr<PageResult> result)
+	{
+		auto node = result.release();
+		node->next = m_head.load(std::memory_order_relaxed);
+		while (!m_head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	std::vector<std::unique_ptr<PageResult>> ResultQueue::TakeAll()
+	{
+		std::vector<std::unique_ptr<PageResult>> ret;
+		for (auto node = m_head.exchange(nullptr, std::memory_order_acquire); node;)
+		{
+			auto next = node->next;
+			node->next = nullptr;
+			ret.emplace_back(node);
+			node = next;
+		}
+		// pushed newest first
+		std::reverse(ret.begin(), ret.end());
+		return ret;
+	}
+
+	DbDataSet::~DbDataSet()
+	{
+		stopRequests();
+	}
+
+	uint64_t DbDataSet::Submit(const std::shared_ptr<ResultQueue>& queue, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, int offset, int limit, const fnLogger& logger)
+	{
+		return queueRequest(PageRequest{ queue, table, sort, filter, projection, logger, offset, limit });
+	}
+
+	uint64_t DbDataSet::SubmitRowIds(const std::shared_ptr<ResultQueue>& queue, const DbTableMetaData& table, const Projection& projection, std::vector<uint32_t> ids, const fnLogger& logger)
+	{
+		PageRequest request{ queue, table, {}, {}, projection, logger };
+		request.byId = true;
+		request.rowIds = std::move(ids);
+		return queueRequest(std::move(request));
+	}
+
+	uint64_t DbDataSet::queueRequest(PageRequest request)
+	{
+		std::lock_guard lock(m_requestLock);
+
+		if (!m_worker.joinable())
+		{
+			m_stopping = false;
+			m_worker = std::thread(&DbDataSet::runRequests, this);
+		}
+
+		request.ticket = ++m_tickets;
+		m_requests.push_back(std::move(request));
+		m_requestWake.notify_one();
+		return m_tickets;
+	}
+
+	void DbDataSet::Cancel(const ResultQueue* queue, bool running)
+	{
+		std::lock_guard lock(m_requestLock);
+
+		std::erase_if(m_requests, [&](const PageRequest& request) { return request.queue.get() == queue; });
+
+		if (running && m_running && m_running == queue)
+		{
+			m_runningCancelled = true;
+			m_async.Interrupt();
+		}
+	}
+
+	void DbDataSet::runRequests()
+	{
+		std::vector<ValType> row;
+
+		for (;;)
+		{
+			PageRequest request;
+			{
+				std::unique_lock lock(m_requestLock);
+				m_requestWake.wait(lock, [this]() { return m_stopping || !m_requests.empty(); });
+				if (m_stopping)
+					return;
+
+				// pages are on screen, counts only size the scroll bar
+				auto next = std::find_if(m_requests.begin(), m_requests.end(), [](const PageRequest& request) { return !request.count; });
+				if (next == m_requests.end())
+					next = m_requests.begin();
+				request = std::move(*next);
+				m_requests.erase(next);
+				m_running = request.queue.get();
+				m_countingStore = request.count ? request.table.store.get() : nullptr;
+				m_countingKey = request.count ? filterValues(request.filter) : std::string();
+				m_runningCancelled = false;
+				m_async.ResetInterrupt();
+			}
+
+			if (request.count)
+			{
+				runCount(request);
+
+				std::lock_guard lock(m_requestLock);
+				m_asyncStats = m_async.statements.GetStats();
+				m_countingStore = nullptr;
+				m_countingKey.clear();
+				continue;
+			}
+
+			auto result = std::make_unique<PageResult>();
+			result->ticket = request.ticket;
+			result->offset = request.offset;
+			m_async.readFailed = false;
+
+			if (request.byId)
+			{
+				result->rows.reserve(request.rowIds.size());
+				auto collect = [&](const RowBatch& batch)
+					{
+						deliverRows(batch, row, [&](const std::vector<ValType>& values) { result->rows.push_back(values); });
+					};
+				visitRowIds(m_async, request.table, request.projection, request.rowIds, BatchSink::Of(collect), request.logger);
+			}
+			else if (request.ids)
+			{
+				result->ids.reserve(size_t(request.limit));
+				auto collect = [&](const RowBatch& batch)
+					{
+						for (size_t i = 0; i < batch.rows; ++i)
+							result->ids.push_back(uint32_t(std::get<int64_t>(batch.Row(i)[0])));
+					};
+				visitRows(m_async, request.table, request.sort, request.filter, request.projection, BatchSink::Of(collect), request.logger, request.limit, request.offset);
+			}
+			else
+			{
+				result->rows.reserve(size_t(request.limit));
+				auto collect = [&](const RowBatch& batch)
+					{
+						deliverRows(batch, row, [&](const std::vector<ValType>& values) { result->rows.push_back(values); });
+					};
+				visitRows(m_async, request.table, request.sort, request.filter, request.projection, BatchSink::Of(collect), request.logger, request.limit, request.offset);
+			}
+
+			result->failed = m_async.readFailed;
+
+			std::lock_guard lock(m_requestLock);
+			m_asyncStats = m_async.statements.GetStats();
+			m_running = nullptr;
+			if (!m_runningCancelled)
+				request.queue->Push(std::move(result));
+		}
+	}
+
+	void DbDataSet::stopRequests()
+	{
+		{
+			std::lock_guard lock(m_requestLock);
+			m_stopping = true;
+			m_requests.clear();
+			if (m_running || m_countingStore)
+			{
+				m_runningCancelled = true;
+				m_async.Interrupt();
+			}
+		}
+		m_requestWake.notify_one();
+
+		if (m_worker.joinable())
+			m_worker.join();
+	}
+
+	StatementCache::Stats DbDataSet::GetStatementStats() const
+	{
+		StatementCache::Stats ret;
+		{
+			std::lock_guard lock(m_lock);
+			ret = m_reader.statements.GetStats();
+		}
+
+		std::lock_guard lock(m_requestLock);
+		ret.hits += m_asyncStats.hits;
+		ret.misses += m_asyncStats.misses;
+		ret.evictions += m_asyncStats.evictions;
+		ret.prepare_seconds += m_asyncStats.prepare_seconds;
+		return ret;
+	}
+
+	int DbDataSet::runPage(ReadContext& ctx, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const std::vector<int>& columns, const SeekKey* after, int skip, int limit, const BatchSink& sink, const fnLogger& logger, SeekKey* first, SeekKey* last)
+	{
+		// reading one row early gives the seek key for the page start
+		const int before = skip > 0 && first ? 1 : 0;
+		const int keys = int(columns.size());
+
+		std::stringstream ss;
+
+		ss << selectClause(table, columns, sort);
+		// once the order's index is built pages walk it instead of sorting. Equality and prefix filters
+		// leave the choice to the planner, an index on their column usually skips most of the table,
+		// while a broad range picked that way sorts it all again for every page.
+		const bool selective = std::any_of(filter.columns.begin(), filter.columns.end(), [](const ColumnFilter& cf)
+			{
+				return cf.op == FilterOp::Equals || (cf.op == FilterOp::Prefix && !cf.value.empty());
+			});
+		if (auto index = sort.empty() || selective ? std::string() : table.store->ReadyIndex(sort); !index.empty())
+		{
+			ss << " INDEXED BY `" << index << "`";
+		}
+		// the seek key's positional parameters come first, the filter's named ones are numbered after them
+		const auto where = filterClause(table, filter);
+		if (after)
+		{
+			ss << " WHERE " << seekClause(table, sort);
+		}
+		if (!where.empty())
+		{
+			ss << (after ? " AND (" : " WHERE (") << where << ")";
+		}
+		ss << orderClause(table, sort);
+		ss << " LIMIT :limit OFFSET :offset;";
+		const auto sql = ss.str();
+
+		auto db = ctx.Connection(*table.store);
+		if (!db)
+		{
+			LOG_TO(logger, "Failed to open a connection to " << table.store->name << "\n");
+			ctx.readFailed = true;
+			return 0;
+		}
+
+		auto stmt = ctx.statements.Acquire(db, sql);
+		if (!stmt)
+		{
+			LOG_TO(logger, "Failed to prepare " << sql << " error " << sqlite3_errmsg(db) << "\n");
+			ctx.readFailed = true;
+			return 0;
+		}
+
+		if (after)
+		{
+			bindSeek(stmt, *after);
+		}
+		bindFilter(stmt, table, filter);
+		sqlite3_bind_int(stmt, sqlite3_bind_parameter_index(stmt, ":limit"), limit ? limit + before : -1);
+		sqlite3_bind_int(stmt, sqlite3_bind_parameter_index(stmt, ":offset"), skip - before);
+
+		BatchWriter writer(ctx, table, columns, sink);
+
+		int ret = SQLITE_OK;
+
+		int rows = 0;
+		int seen = 0;
+		bool stepping = true;
+		while (stepping)
+		{
+			ret = sqlite3_step(stmt);
+			switch (ret)
+			{
+			case SQLITE_ROW:
+			{
+				if (seen++ < before)
+				{
+					*first = readSeek(stmt, table, sort, keys);
+					break;
+				}
+
+				writer.Add(stmt);
+
+				if (++rows == limit && last)
+				{
+					*last = readSeek(stmt, table, sort, keys);
+				}
+				break;
+			}
+			case SQLITE_DONE:
+				stepping = false;
+				break;
+			case SQLITE_INTERRUPT:
+				// cancelled
+				stepping = false;
+				break;
+			default:
+				LOG_TO(logger, "Failed stepping " << sql << " error " << ret << "\n");
+				stepping = false;
+				break;
+			}
+		}
+
+		sqlite3_reset(stmt);
+		writer.Flush();
+		if (ret != SQLITE_DONE)
+			ctx.readFailed = true;
+		return rows;
+	}
+
+	SortPositions& DbDataSet::sortPositions(ReadContext& ctx, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const fnLogger& logger, bool build)
+	{
+		// positions count matching rows only, so each filter has its own
+		const auto where = filterClause(table, filter);
+		auto& ret = ctx.positions[{ table.store.get(), orderClause(table, sort) + "\n" + filterKey(table, filter) }];
+		if (ret.built || !build)
+			return ret;
+
+		ret.built = true;
+
+		// one pass over the whole order, keeping the key of the last row before every stride boundary
+		std::stringstream ss;
+		ss << selectClause(table, { 0 }, sort);
+		if (!where.empty())
+		{
+			ss << " WHERE " << where;
+		}
+		ss << orderClause(table, sort) << ";";
+
+		auto db = ctx.Connection(*table.store);
+
+		sqlite3_stmt* stmt = nullptr;
+		const auto sql = ss.str();
+		if (!db || sqlite3_prepare_v2(db, sql.c_str(), int(sql.size()), &stmt, nullptr) != SQLITE_OK)
+		{
+			LOG_TO(logger, "Failed to exec " << sql << "\n");
+			sqlite3_finalize(stmt);
+			return ret;
+		}
+		bindFilter(stmt, table, filter);
+
+		int position = 0;
+		int rc = SQLITE_OK;
+		while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+		{
+			if (++position % checkpointStride == 0)
+			{
+				ret.checkpoints.push_back(readSeek(stmt, table, sort, 1));
+			}
+		}
+		sqlite3_finalize(stmt);
+
+		// an interrupted pass is built again next time
+		if (rc != SQLITE_DONE)
+		{
+			ret.built = false;
+			ret.checkpoints.clear();
+		}
+
+		return ret;
+	}
+
+	void DbDataSet::GetRows(const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, fnRow fnOnRow, const fnLogger& logger, int limit, int offset)
+	{
+		std::vector<ValType> row;
+		VisitRows(table, sort, filter, projection, [&](const RowBatch& batch) { deliverRows(batch, row, fnOnRow); }, logger, limit, offset);
+	}
+
+	int DbDataSet::runRowIds(ReadContext& ctx, const DbTableMetaData& table, const std::vector<int>& columns, const std::vector<uint32_t>& ids, const BatchSink& sink, const fnLogger& logger)
+	{
+		std::stringstream ss;
+		ss << selectClause(table, columns, {}) << " WHERE row_id = ?1;";
+		const auto sql = ss.str();
+
+		auto db = ctx.Connection(*table.store);
+		if (!db)
+		{
+			LOG_TO(logger, "Failed to open a connection to " << table.store->name << "\n");
+			ctx.readFailed = true;
+			return 0;
+		}
+
+		auto stmt = ctx.statements.Acquire(db, sql);
+		if (!stmt)
+		{
+			LOG_TO(logger, "Failed to prepare " << sql << " error " << sqlite3_errmsg(db) << "\n");
+			ctx.readFailed = true;
+			return 0;
+		}
+
+		BatchWriter writer(ctx, table, columns, sink);
+
+		int rows = 0;
+		for (auto id : ids)
+		{
+			sqlite3_bind_int64(stmt, 1, id);
+			const auto rc = sqlite3_step(stmt);
+			if (rc == SQLITE_ROW)
+			{
+				writer.Add(stmt);
+				rows++;
+			}
+			sqlite3_reset(stmt);
+
+			if (rc == SQLITE_INTERRUPT)
+			{
+				ctx.readFailed = true;
+				break;
+			}
+			if (rc != SQLITE_ROW)
+			{
+				LOG_TO(logger, "Failed stepping " << sql << " error " << rc << "\n");
+				ctx.readFailed = true;
+				break;
+			}
+		}
+
+		writer.Flush();
+		return rows;
+	}
+
+	void DbDataSet::GetRowIds(const DbTableMetaData& table, const Projection& projection, const std::vector<uint32_t>& ids, fnRow fnOnRow, const fnLogger& logger)
+	{
+		std::vector<ValType> row;
+		VisitRowIds(table, projection, ids, [&](const RowBatch& batch) { deliverRows(batch, row, fnOnRow); }, logger);
+	}
+
+	void DbDataSet::visitRowIds(ReadContext& ctx, const DbTableMetaData& table, const Projection& projection, const std::vector<uint32_t>& ids, const BatchSink& sink, const fnLogger& logger)
+	{
+		auto& columns = ctx.batchColumns;
+		projectedColumns(table, projection, columns);
+		runRowIds(ctx, table, columns, ids, sink, logger);
+	}
+
+	void DbDataSet::visitRows(ReadContext& ctx, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, const BatchSink& sink, const fnLogger& logger, int limit, int offset)
+	{
+		auto& columns = ctx.batchColumns;
+		projectedColumns(table, projection, columns);
+
+		for (const auto& cf : filter.columns)
+		{
+			// comparisons and prefixes seek in an index on the column, contains and numeric ranges scan anyway
+			if (cf.op == FilterOp::Equals || cf.op == FilterOp::Prefix || cf.op == FilterOp::Range)
+				table.store->RequestIndex({ { cf.column, false } });
+		}
+
+		// a sorted permutation turns the page into row id lookups, either direction. Filtered views page through sql,
+		// on an index of the sort, as do sorts that get no permutation. Only one of the two is built for a sort.
+		bool reversed = false;
+		const auto normalized = normalizedSort(sort, reversed);
+		if (auto permutation = sort.empty() || !filter.empty() ? nullptr : s_permutations.Find(table.store.get(), normalized))
+		{
+			auto& ids = ctx.batchIds;
+			permutation->Slice(size_t(offset), limit ? size_t(limit) : permutation->rows.size(), reversed, ids);
+			runRowIds(ctx, table, columns, ids, sink, logger);
+			return;
+		}
+		if (!filter.empty() || !requestPermutation(table.store, normalized))
+		{
+			table.store->RequestIndex(sort);
+		}
+
+		// unsorted, row ids are the positions
+		if (sort.empty() && filter.empty())
+		{
+			SeekKey start;
+			start.row_id = offset - 1;
+			runPage(ctx, table, sort, filter, columns, offset > 0 ? &start : nullptr, 0, limit, sink, logger, nullptr, nullptr);
+			return;
+		}
+
+		if (offset < checkpointStride)
+		{
+			runPage(ctx, table, sort, filter, columns, nullptr, offset, limit, sink, logger, nullptr, nullptr);
+			return;
+		}
+
+		// a position seen on an earlier page is the cheapest place to start, then the stride checkpoints
+		auto& positions = sortPositions(ctx, table, sort, filter, logger, false);
+
+		const SeekKey* after = nullptr;
+		int from = 0;
+
+		auto seen = positions.seen.upper_bound(offset);
+		if (seen != positions.seen.begin() && offset - std::prev(seen)->first < checkpointStride)
+		{
+			--seen;
+			after = &seen->second;
+			from = seen->first;
+		}
+		else
+		{
+			auto& built = sortPositions(ctx, table, sort, filter, logger, true);
+			auto index = std::min(size_t(offset / checkpointStride), built.checkpoints.size());
+			if (index)
+			{
+				after = &built.checkpoints[index - 1];
+				from = int(index) * checkpointStride;
+			}
+		}
+
+		SeekKey first, last;
+		const bool haveFirst = offset > from;
+		auto rows = runPage(ctx, table, sort, filter, columns, after, offset - from, limit, sink, logger, haveFirst ? &first : nullptr, &last);
+
+		if (positions.seen.size() > maxSeenPositions)
+			positions.seen.clear();
+		// a page past the last row never reads its start
+		if (haveFirst && first.row_id >= 0)
+			positions.seen[offset] = std::move(first);
+		if (limit && rows == limit)
+			positions.seen[offset + limit] = std::move(last);
+	}
+
+	uint64_t DbDataSet::SelectRange(const std::shared_ptr<ResultQueue>& queue, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, int from, int to, RowSelection& selection, const fnLogger& logger)
+	{
+		from = std::max(from, 0);
+		if (from >= to)
+			return 0;
+
+		// unsorted, row ids are the positions
+		if (sort.empty() && filter.empty())
+		{
+			selection.AddRange(uint32_t(from), uint64_t(std::min<size_t>(size_t(to), table.count)));
+			return 0;
+		}
+
+		bool reversed = false;
+		const auto normalized = normalizedSort(sort, reversed);
+		if (auto permutation = filter.empty() ? s_permutations.Find(table.store.get(), normalized) : nullptr)
+		{
+			std::vector<uint32_t> ids;
+			permutation->Slice(size_t(from), size_t(to - from), reversed, ids);
+			for (auto id : ids)
+				selection.Add(id);
+			return 0;
+		}
+
+		PageRequest request{ queue, table, sort, filter, { 0 }, logger, from, to - from };
+		request.ids = true;
+		return queueRequest(std::move(request));
+	}
+
+	std::shared_ptr<ExportJob> DbDataSet::Export(const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, const RowSelection* selection, const ExportOptions& options, fnWrite fnOut, const fnLogger& logger)
+	{
+		auto ret = std::make_shared<ExportJob>();
+		// a filtered view's count can still be an estimate
+		ret->m_total = selection ? selection->Count() : uint64_t(std::max<int64_t>(GetCount(table, filter, logger).rows, 0));
+		auto rows = selection ? std::make_shared<const RowSelection>(*selection) : nullptr;
+
+		// the job joins the thread before it goes, the data set is kept alive by it
+		ret->start([self = shared_from_this(), job = ret.get(), table, sort, filter, projection, rows, options, fnOut = std::move(fnOut), logger]() mutable
+			{
+				self->runExport(*job, table, sort, filter, projection, rows.get(), options, fnOut, logger);
+				fnOut = nullptr;
+			});
+		return ret;
+	}
+
+	void DbDataSet::runExport(ExportJob& job, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, const RowSelection* selection, const ExportOptions& options, const fnWrite& fnOut, const fnLogger& logger)
+	{
+		// a failed write interrupts the read, which is otherwise one statement to the end of the view
+		const bool arrow = options.format == ExportFormat::Arrow;
+		ExportPipe pipe(fnOut, options.compress && !arrow, job.m_failed, job.m_cancelled, [&job]() { job.m_ctx.Interrupt(); });
+		// a selection is done once all of its rows are out, the rest of a sorted or filtered view isn't read
+		bool complete = selection && !selection->Count();
+		auto stopped = [&]() { return job.m_cancelled || job.m_failed || complete; };
+
+		std::vector<int> columns;
+		projectedColumns(table, projection, columns);
+
+		// every cell of the view into out, a TextFormatter or an ArrowWriter
+		uint64_t rows = 0;
+		auto read = [&](auto& out)
+			{
+				auto write = [&](const RowBatch& batch)
+					{
+						if (stopped())
+							return;
+
+						for (size_t row = 0; row < batch.rows; ++row)
+						{
+							auto cells = batch.Row(row);
+							if (selection && !selection->Contains(uint32_t(std::get<int64_t>(cells[0]))))
+								continue;
+
+							for (size_t i = 0; i < cells.size(); ++i)
+							{
+								if (auto value = std::get_if<int64_t>(&cells[i]))
+									out.Integer(*value);
+								else if (auto real = std::get_if<double>(&cells[i]))
+									out.Real(*real);
+								else
+									out.Text(std::get<std::string_view>(cells[i]));
+								out.EndCell(i + 1 == cells.size());
+							}
+							rows++;
+							if (selection && rows == selection->Count())
+							{
+								complete = true;
+								job.m_ctx.Interrupt();
+								break;
+							}
+						}
+						job.m_rows = rows;
+					};
+
+				if (sort.empty() && filter.empty() && selection)
+				{
+					// unsorted, each run of selected row ids is one read
+					selection->VisitRanges([&](uint64_t from, uint64_t to)
+						{
+							if (!stopped())
+								visitRows(job.m_ctx, table, sort, filter, projection, BatchSink::Of(write), logger, int(to - from), int(from));
+						});
+				}
+				else if (!stopped())
+				{
+					// The whole order in one statement, walking its index once built or sorting once. A sort permutation
+					// isn't used, its row id lookups cost a statement each and come out slower than either.
+					runPage(job.m_ctx, table, sort, filter, columns, nullptr, 0, 0, BatchSink::Of(write), logger, nullptr, nullptr);
+				}
+			};
+
+		if (arrow)
+		{
+			// types are settled before the schema goes out, dictionary columns then come as codes
+			ArrowWriter out(pipe, arrowColumns(table, columns));
+			job.m_ctx.dictionaryCodes = true;
+			read(out);
+			out.Finish();
+		}
+		else
+		{
+			TextFormatter out(pipe, options.format);
+			for (size_t i = 0; i < columns.size(); ++i)
+			{
+				out.Text(table.columns[columns[i]]);
+				out.EndCell(i + 1 == columns.size());
+			}
+			read(out);
+			out.Flush();
+		}
+
+		pipe.Finish();
+		if (job.m_failed)
+			LOG_TO(logger, "Failed writing the export of " << table.store->name << "\n");
+	}
+
+	BackgroundJob::~BackgroundJob()
+	{
+		// a job's thread runs on its own members, its destructor stops it while they're there
+		assert(!m_thread.joinable());
+	}
+
+	void BackgroundJob::stop()
+	{
+		Cancel();
+		if (m_thread.joinable())
+			m_thread.join();
+	}
+
+	void BackgroundJob::Cancel()
+	{
+		m_cancelled = true;
+		m_ctx.Interrupt();
+	}
+
+	ExportJob::~ExportJob()
+	{
+		stop();
+	}
+
+	std::shared_ptr<GroupByJob> DbDataSet::GroupBy(const DbTableMetaData& table, const GroupBySpec& spec, const fnLogger& logger)
+	{
+		const auto key = groupKey(table, spec);
+
+		// dropping a job waits for its thread, so it happens after the lock is let go
+		std::shared_ptr<GroupByJob> dropped;
+		std::lock_guard lock(m_requestLock);
+
+		// a job that didn't finish is run again
+		if (auto found = m_groups.Find(table.store.get(), key, table.count, dropped))
+			return found;
+
+		auto ret = std::make_shared<GroupByJob>();
+		ret->m_total = table.count;
+
+		// the job joins the thread before it goes, the table's store is kept alive by the copy
+		ret->start([job = ret.get(), table, spec, logger]() { job->run(table, spec, logger); });
+
+		m_groups.Add(table.store.get(), key, ret, maxGroupJobs, dropped);
+		return ret;
+	}
+
+	void GroupByJob::run(const DbTableMetaData& table, const GroupBySpec& spec, const fnLogger& logger)
+	{
+		const auto& dictionaries = table.store->dictionaries;
+		const auto where = filterClause(table, spec.filter);
+
+		auto db = m_ctx.Connection(*table.store);
+		if (!db)
+		{
+			LOG_TO(logger, "Failed to open " << table.store->name << " for a group by\n");
+			m_failed = true;
+			return;
+		}
+
+		// a dictionary's values as numbers by code, NaN for those that aren't one
+		auto codeValues = [&](int column)
+			{
+				std::vector<double> ret(dictionaries[column].size(), std::numeric_limits<double>::quiet_NaN());
+				const auto sql = "SELECT code, number(value) FROM `" + dictionaryTable(table.store->name, size_t(column)) + "`;";
+				auto stmt = m_ctx.statements.Acquire(db, sql);
+				while (stmt && sqlite3_step(stmt) == SQLITE_ROW)
+				{
+					const auto code = sqlite3_column_int64(stmt, 0);
+					if (code >= 0 && code < int64_t(ret.size()) && sqlite3_column_type(stmt, 1) != SQLITE_NULL)
+						ret[size_t(code)] = sqlite3_column_double(stmt, 1);
+				}
+				if (stmt)
+					sqlite3_reset(stmt);
+				return ret;
+			};
+
+		// every aggregate but a count reads sum, count, min and max of its column, which are merged across blocks.
+		// Dictionary columns are grouped by code instead and the codes' values added up here.
+		std::vector<int> partialColumns;
+		std::vector<std::vector<double>> partialCodes;
+		std::vector<std::string> groupBy;
+
+		std::stringstream ss;
+		ss << "SELECT COUNT(*)";
+		for (auto key : spec.keys)
+		{
+			ss << ", " << columnSql(table, key);
+			groupBy.push_back(columnSql(table, key));
+		}
+		int column = 1 + int(spec.keys.size());
+		for (const auto& aggregate : spec.aggregates)
+		{
+			if (aggregate.op == AggregateOp::Count)
+				continue;
+
+			partialColumns.push_back(column);
+			if (aggregate.column != 0 && !dictionaries[aggregate.column].empty())
+			{
+				ss << ", " << columnSql(table, aggregate.column);
+				groupBy.push_back(columnSql(table, aggregate.column));
+				partialCodes.push_back(codeValues(aggregate.column));
+				column += 1;
+				continue;
+			}
+
+			const auto value = aggregate.column == 0 ? std::string("row_id") : "number(" + columnSql(table, aggregate.column) + ")";
+			ss << ", SUM(" << value << "), COUNT(" << value << "), MIN(" << value << "), MAX(" << value << ")";
+			partialCodes.emplace_back();
+			column += 4;
+		}
+		ss << " FROM `" << table.store->name << "` WHERE row_id >= ?1 AND row_id < ?2";
+		if (!where.empty())
+			ss << " AND (" << where << ")";
+		for (size_t i = 0; i < groupBy.size(); ++i)
+		{
+			ss << (i ? ", " : " GROUP BY ") << groupBy[i];
+		}
+		ss << ";";
+		const auto sql = ss.str();
+
+		struct Partial
+		{
+			double sum = 0;
+			int64_t count = 0;
+			double min = 0;
+			double max = 0;
+		};
+		struct Group
+		{
+			std::vector<std::string> keys;
+			int64_t rows = 0;
+			std::vector<Partial> partials;
+		};
+		std::vector<Group> groups;
+		// key values joined by tabs, which cells never hold
+		std::unordered_map<std::string, size_t> index;
+		bool truncated = false;
+
+		auto publish = [&](uint64_t scanned)
+			{
+				auto result = std::make_shared<GroupResult>();
+				result->scanned = scanned;
+				result->total = m_total;
+				result->truncated = truncated;
+				result->groups.reserve(groups.size());
+				for (const auto& group : groups)
+				{
+					auto& row = result->groups.emplace_back();
+					row.keys = group.keys;
+					row.rows = group.rows;
+					size_t partial = 0;
+					for (const auto& aggregate : spec.aggregates)
+					{
+						if (aggregate.op == AggregateOp::Count)
+						{
+							row.values.push_back(double(group.rows));
+							continue;
+						}
+
+						const auto& p = group.partials[partial++];
+						auto value = std::numeric_limits<double>::quiet_NaN();
+						if (p.count > 0)
+						{
+							switch (aggregate.op)
+							{
+							case AggregateOp::Sum: value = p.sum; break;
+							case AggregateOp::Min: value = p.min; break;
+							case AggregateOp::Max: value = p.max; break;
+							case AggregateOp::Avg: value = p.sum / double(p.count); break;
+							default: break;
+							}
+						}
+						row.values.push_back(value);
+					}
+				}
+				std::sort(result->groups.begin(), result->groups.end(), [](const GroupRow& a, const GroupRow& b) { return a.rows != b.rows ? a.rows > b.rows : a.keys < b.keys; });
+
+				std::lock_guard lock(m_lock);
+				m_result = std::move(result);
+			};
+
+		auto stmt = m_ctx.statements.Acquire(db, sql);
+		if (!stmt)
+		{
+			LOG_TO(logger, "Failed to prepare " << sql << "\n");
+			m_failed = true;
+			return;
+		}
+
+		const auto partials = partialColumns.size();
+		const auto keys = int(spec.keys.size());
+		std::string joined;
+		StopWatch sincePublish;
+
+		for (int64_t from = 0; from < int64_t(m_total) && !m_cancelled; from += scanBlockRows)
+		{
+			sqlite3_bind_int64(stmt, 1, from);
+			sqlite3_bind_int64(stmt, 2, from + scanBlockRows);
+			bindFilter(stmt, table, spec.filter);
+
+			int rc;
+			while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+			{
+				const auto rows = sqlite3_column_int64(stmt, 0);
+				if (rows == 0)
+					continue;
+
+				joined.clear();
+				for (int i = 0; i < keys; ++i)
+				{
+					const auto& dict = dictionaries[spec.keys[i]];
+					if (!dict.empty())
+					{
+						auto code = sqlite3_column_type(stmt, i + 1) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, i + 1);
+						if (code >= 0 && code < int(dict.size()))
+							joined += dict[code];
+					}
+					else if (auto text = sqlite3_column_text(stmt, i + 1))
+					{
+						joined.append(reinterpret_cast<const char*>(text), size_t(sqlite3_column_bytes(stmt, i + 1)));
+					}
+					joined.push_back('\t');
+				}
+
+				auto found = index.find(joined);
+				if (found == index.end())
+				{
+					if (groups.size() >= maxGroups)
+					{
+						truncated = true;
+						continue;
+					}
+
+					found = index.emplace(joined, groups.size()).first;
+					auto& group = groups.emplace_back();
+					group.partials.resize(partials);
+					for (size_t at = 0; at < joined.size();)
+					{
+						const auto end = joined.find('\t', at);
+						group.keys.emplace_back(joined, at, end - at);
+						at = end + 1;
+					}
+				}
+
+				auto& group = groups[found->second];
+				group.rows += rows;
+				for (size_t i = 0; i < partials; ++i)
+				{
+					const int at = partialColumns[i];
+					auto& p = group.partials[i];
+					double sum, min, max;
+					int64_t count;
+					if (const auto& codes = partialCodes[i]; !codes.empty())
+					{
+						const auto code = sqlite3_column_type(stmt, at) == SQLITE_NULL ? -1 : sqlite3_column_int64(stmt, at);
+						if (code < 0 || code >= int64_t(codes.size()) || std::isnan(codes[size_t(code)]))
+							continue;
+						min = max = codes[size_t(code)];
+						sum = min * double(rows);
+						count = rows;
+					}
+					else
+					{
+						count = sqlite3_column_int64(stmt, at + 1);
+						if (count == 0)
+							continue;
+						sum = sqlite3_column_double(stmt, at);
+						min = sqlite3_column_double(stmt, at + 2);
+						max = sqlite3_column_double(stmt, at + 3);
+					}
+
+					p.min = p.count ? std::min(p.min, min) : min;
+					p.max = p.count ? std::max(p.max, max) : max;
+					p.sum += sum;
+					p.count += count;
+				}
+			}
+			sqlite3_reset(stmt);
+
+			if (rc != SQLITE_DONE)
+			{
+				if (rc != SQLITE_INTERRUPT)
+				{
+					LOG_TO(logger, "Failed stepping " << sql << " error " << rc << "\n");
+					m_failed = true;
+				}
+				break;
+			}
+
+			const auto scanned = uint64_t(std::min<int64_t>(from + scanBlockRows, int64_t(m_total)));
+			if (scanned == m_total || sincePublish.Seconds() * 1000 >= scanPublishMs)
+			{
+				publish(scanned);
+				sincePublish = {};
+			}
+		}
+
+		// an empty table has no blocks
+		if (m_total == 0)
+			publish(0);
+	}
+
+	GroupByJob::~GroupByJob()
+	{
+		stop();
+	}
+
+	std::shared_ptr<const GroupResult> GroupByJob::Result() const
+	{
+		std::lock_guard lock(m_lock);
+		return m_result;
+	}
+
+	std::shared_ptr<ProfileJob> DbDataSet::Profile(const DbTableMetaData& table, int column, const RowFilter& filter, const fnLogger& logger)
+	{
+		const auto key = std::to_string(column) + "\n" + filterKey(table, filter);
+
+		// dropping a job waits for its thread, so it happens after the lock is let go
+		std::shared_ptr<ProfileJob> dropped;
+		std::lock_guard lock(m_requestLock);
+
+		if (auto found = m_profiles.Find(table.store.get(), key, table.count, dropped))
+			return found;
+
+		auto ret = std::make_shared<ProfileJob>();
+		ret->m_total = table.count;
+		ret->start([job = ret.get(), table, column, filter, logger]() { job->run(table, column, filter, logger); });
+
+		m_profiles.Add(table.store.get(), key, ret, maxProfileJobs, dropped);
+		return ret;
+	}
+
+	void ProfileJob::run(const DbTableMetaData& table, int column, const RowFilter& filter, const fnLogger& logger)
+	{
+		const auto& dict = table.store->dictionaries[column];
+		const auto where = filterClause(table, filter);
+
+		// dictionary columns are counted by code, each value is parsed once
+		std::stringstream ss;
+		ss << "SELECT " << columnSql(table, column) << (dict.empty() ? ", 1" : ", COUNT(*)") << " FROM `" << table.store->name << "` WHERE row_id >= ?1 AND row_id < ?2";
+		if (!where.empty())
+			ss << " AND (" << where << ")";
+		if (!dict.empty())
+			ss << " GROUP BY " << columnSql(table, column);
+		ss << ";";
+		const auto sql = ss.str();
+
+		auto db = m_ctx.Connection(*table.store);
+		auto stmt = db ? m_ctx.statements.Acquire(db, sql) : nullptr;
+		if (!stmt)
+		{
+			LOG_TO(logger, "Failed to prepare " << sql << "\n");
+			m_failed = true;
+			return;
+		}
+
+		TDigest digest;
+		Histogram histogram;
+		auto result = std::make_shared<ColumnProfile>();
+		result->total = m_total;
+		double sum = 0;
+
+		auto add = [&](std::string_view text, uint64_t count)
+			{
+				double value;
+				if (text.empty())
+				{
+					result->empties += count;
+				}
+				else if (!ParseNumber(text, value))
+				{
+					result->texts += count;
+				}
+				else
+				{
+					result->min = result->numbers ? std::min(result->min, value) : value;
+					result->max = result->numbers ? std::max(result->max, value) : value;
+					result->numbers += count;
+					sum += value * double(count);
+					digest.Add(value, count);
+					histogram.Add(value, count);
+				}
+			};
+
+		auto publish = [&](uint64_t scanned)
+			{
+				digest.Compress();
+				result->scanned = scanned;
+				result->mean = result->numbers ? sum / double(result->numbers) : 0;
+				result->quantiles.clear();
+				for (auto q : profileQuantiles)
+				{
+					result->quantiles.push_back(digest.Quantile(q));
+				}
+				result->histogramLow = histogram.Low();
+				result->binWidth = histogram.Width();
+				result->bins.assign(histogram.Counts().begin(), histogram.Counts().end());
+
+				auto published = std::make_shared<ColumnProfile>(*result);
+				std::lock_guard lock(m_lock);
+				m_result = std::move(published);
+			};
+
+		StopWatch sincePublish;
+		for (int64_t from = 0; from < int64_t(m_total) && !m_cancelled; from += scanBlockRows)
+		{
+			sqlite3_bind_int64(stmt, 1, from);
+			sqlite3_bind_int64(stmt, 2, from + scanBlockRows);
+			bindFilter(stmt, table, filter);
+
+			int rc;
+			while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+			{
+				const auto count = uint64_t(sqlite3_column_int64(stmt, 1));
+				if (!dict.empty())
+				{
+					auto code = sqlite3_column_type(stmt, 0) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 0);
+					add(code >= 0 && code < int(dict.size()) ? std::string_view(dict[code]) : std::string_view(), count);
+				}
+				else
+				{
+					auto text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+					add(text ? std::string_view(text, size_t(sqlite3_column_bytes(stmt, 0))) : std::string_view(), count);
+				}
+			}
+			sqlite3_reset(stmt);
+
+			if (rc != SQLITE_DONE)
+			{
+				if (rc != SQLITE_INTERRUPT)
+				{
+					LOG_TO(logger, "Failed stepping " << sql << " error " << rc << "\n");
+					m_failed = true;
+				}
+				break;
+			}
+
+			const auto scanned = uint64_t(std::min<int64_t>(from + scanBlockRows, int64_t(m_total)));
+			if (scanned == m_total || sincePublish.Seconds() * 1000 >= scanPublishMs)
+			{
+				publish(scanned);
+				sincePublish = {};
+			}
+		}
+
+		// an empty table has no blocks
+		if (m_total == 0)
+			publish(0);
+	}
+
+	ProfileJob::~ProfileJob()
+	{
+		stop();
+	}
+
+	std::shared_ptr<const ColumnProfile> ProfileJob::Result() const
+	{
+		std::lock_guard lock(m_lock);
+		return m_result;
+	}
+
+	std::shared_ptr<JoinJob> DbDataSet::Join(const DbTableMetaData& left, int leftColumn, const DbTableMetaData& right, int rightColumn, const fnLogger& logger)
+	{
+		auto ret = std::make_shared<JoinJob>();
+		ret->m_total = left.count + right.count;
+
+		// the job joins the thread before it goes, the tables' stores are kept alive by the copies
+		ret->start([job = ret.get(), left, leftColumn, right, rightColumn, logger]() { job->run(left, leftColumn, right, rightColumn, logger); });
+		return ret;
+	}
+
+	void JoinJob::run(const DbTableMetaData& left, int leftColumn, const DbTableMetaData& right, int rightColumn, const fnLogger& logger)
+	{
+		// row ids and keys of a table in blocks, rows with an empty key are left out
+		auto scan = [&](const DbTableMetaData& table, int column, auto&& fnKey)
+			{
+				const auto& dict = table.store->dictionaries[column];
+
+				std::stringstream ss;
+				ss << "SELECT row_id, " << columnSql(table, column) << " FROM `" << table.store->name << "` WHERE row_id >= ?1 AND row_id < ?2;";
+				const auto sql = ss.str();
+
+				auto db = m_ctx.Connection(*table.store);
+				auto stmt = db ? m_ctx.statements.Acquire(db, sql) : nullptr;
+				if (!stmt)
+				{
+					LOG_TO(logger, "Failed to prepare " << sql << "\n");
+					m_failed = true;
+					return false;
+				}
+
+				for (int64_t from = 0; from < int64_t(table.count) && !m_cancelled; from += scanBlockRows)
+				{
+					sqlite3_bind_int64(stmt, 1, from);
+					sqlite3_bind_int64(stmt, 2, from + scanBlockRows);
+
+					int rc;
+					while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+					{
+						const auto id = uint32_t(sqlite3_column_int64(stmt, 0));
+						std::string_view key;
+						if (!dict.empty())
+						{
+							auto code = sqlite3_column_type(stmt, 1) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 1);
+							if (code >= 0 && code < int(dict.size()))
+								key = dict[code];
+						}
+						else if (auto text = sqlite3_column_text(stmt, 1))
+						{
+							key = std::string_view(reinterpret_cast<const char*>(text), size_t(sqlite3_column_bytes(stmt, 1)));
+						}
+						if (!key.empty() && !fnKey(id, key))
+							break;
+					}
+					sqlite3_reset(stmt);
+
+					if (rc != SQLITE_DONE && rc != SQLITE_ROW)
+					{
+						if (rc != SQLITE_INTERRUPT)
+						{
+							LOG_TO(logger, "Failed stepping " << sql << " error " << rc << "\n");
+							m_failed = true;
+						}
+						return false;
+					}
+					if (rc == SQLITE_ROW)
+						return false;
+					m_scanned += uint64_t(std::min<int64_t>(scanBlockRows, int64_t(table.count) - from));
+				}
+				return !m_cancelled;
+			};
+
+		// the smaller table is hashed, chained through arrays with the keys packed in one buffer
+		const bool buildLeft = left.count <= right.count;
+		const auto& build = buildLeft ? left : right;
+		const auto& probe = buildLeft ? right : left;
+
+		struct Entry
+		{
+			uint64_t hash;
+			uint64_t key;
+			uint32_t length;
+			uint32_t row;
+			uint32_t next;
+		};
+		constexpr uint32_t none = UINT32_MAX;
+		std::vector<Entry> entries;
+		std::string keys;
+		const std::hash<std::string_view> hasher;
+
+		if (!scan(build, buildLeft ? leftColumn : rightColumn, [&](uint32_t row, std::string_view key)
+			{
+				entries.push_back({ hasher(key), keys.size(), uint32_t(key.size()), row, none });
+				keys.append(key);
+				return true;
+			}))
+			return;
+
+		size_t buckets = 1;
+		while (buckets < entries.size())
+			buckets *= 2;
+		const auto mask = buckets - 1;
+		std::vector<uint32_t> heads(buckets, none);
+		// linked from the back so each chain runs in row order
+		for (auto i = entries.size(); i-- > 0;)
+		{
+			auto& head = heads[entries[i].hash & mask];
+			entries[i].next = head;
+			head = uint32_t(i);
+		}
+
+		std::vector<JoinPair> pairs;
+		pairs.reserve(chunkPairs);
+		uint64_t found = 0;
+		scan(probe, buildLeft ? rightColumn : leftColumn, [&](uint32_t row, std::string_view key)
+			{
+				const auto hash = hasher(key);
+				for (auto at = heads[hash & mask]; at != none; at = entries[at].next)
+				{
+					const auto& entry = entries[at];
+					if (entry.hash != hash || std::string_view(keys.data() + entry.key, entry.length) != key)
+						continue;
+
+					if (found++ == maxJoinPairs)
+					{
+						m_truncated = true;
+						return false;
+					}
+					pairs.push_back(buildLeft ? JoinPair{ entry.row, row } : JoinPair{ row, entry.row });
+					if (pairs.size() == chunkPairs)
+					{
+						append(pairs);
+						pairs.clear();
+					}
+				}
+				return true;
+			});
+		append(pairs);
+	}
+
+	void JoinJob::append(const std::vector<JoinPair>& pairs)
+	{
+		std::lock_guard lock(m_lock);
+		auto rows = m_rows.load(std::memory_order_relaxed);
+		for (const auto& pair : pairs)
+		{
+			if (rows % chunkPairs == 0)
+				m_chunks.push_back(std::make_unique<JoinPair[]>(chunkPairs));
+			m_chunks.back()[rows % chunkPairs] = pair;
+			rows++;
+		}
+		m_rows.store(rows, std::memory_order_release);
+	}
+
+	void JoinJob::Pairs(uint64_t from, uint64_t to, std::vector<JoinPair>& pairs) const
+	{
+		pairs.clear();
+
+		std::lock_guard lock(m_lock);
+		to = std::min(to, m_rows.load(std::memory_order_relaxed));
+		for (auto at = from; at < to; ++at)
+		{
+			pairs.push_back(m_chunks[at / chunkPairs][at % chunkPairs]);
+		}
+	}
+
+	JoinJob::~JoinJob()
+	{
+		stop();
+	}
+
+	void DbDataSet::GetRowsAfter(const DbTableMetaData& table, const SortSpec& sort, const SeekKey* after, fnRow fnOnRow, const fnLogger& logger, int limit, SeekKey* last)
+	{
+		std::vector<ValType> row;
+		auto deliver = [&](const RowBatch& batch) { deliverRows(batch, row, fnOnRow); };
+
+		std::lock_guard lock(m_lock);
+
+		auto& columns = m_reader.batchColumns;
+		projectedColumns(table, {}, columns);
+		runPage(m_reader, table, sort, {}, columns, after, 0, limit, BatchSink::Of(deliver), logger, nullptr, last);
+	}
+
+	int64_t DbDataSet::countRows(ReadContext& ctx, const DbTableMetaData& table, const RowFilter& filter, const fnLogger& logger, int64_t from, int64_t to)
+	{
+		// row ids are the positions in the file
+		const auto where = filterClause(table, filter);
+		if (where.empty())
+			return std::max<int64_t>(0, std::min(to, int64_t(table.count)) - std::max<int64_t>(from, 0));
+
+		// the bounds are always there so every range shares the statement
+		std::stringstream ss;
+		ss << "SELECT COUNT(*) FROM `" << table.store->name << "` WHERE row_id >= ?1 AND row_id < ?2 AND (" << where << ");";
+		const auto sql = ss.str();
+
+		auto db = ctx.Connection(*table.store);
+		auto stmt = db ? ctx.statements.Acquire(db, sql) : nullptr;
+		if (!stmt)
+		{
+			LOG_TO(logger, "Failed to prepare " << sql << "\n");
+			return -1;
+		}
+		sqlite3_bind_int64(stmt, 1, from);
+		sqlite3_bind_int64(stmt, 2, to);
+		bindFilter(stmt, table, filter);
+
+		int64_t ret = -1;
+		const auto rc = sqlite3_step(stmt);
+		if (rc == SQLITE_ROW)
+		{
+			ret = sqlite3_column_int64(stmt, 0);
+		}
+		else if (rc != SQLITE_INTERRUPT)
+		{
+			LOG_TO(logger, "Failed stepping " << sql << " error " << rc << "\n");
+		}
+		sqlite3_reset(stmt);
+		return ret;
+	}
+
+	int64_t DbDataSet::estimateRows(ReadContext& ctx, const DbTableMetaData& table, const RowFilter& filter, const fnLogger& logger)
+	{
+		const auto rows = int64_t(table.count);
+		if (rows < estimateMinRows)
+			return -1;
+
+		// blocks spread over the table, a filter on a column sorted in the file still gets an even share
+		int64_t matched = 0;
+		for (int64_t block = 0; block < estimateBlocks; ++block)
+		{
+			const auto from = block * (rows - estimateBlockRows) / (estimateBlocks - 1);
+			const auto count = countRows(ctx, table, filter, logger, from, from + estimateBlockRows);
+			if (count < 0)
+				return -1;
+			matched += count;
+		}
+		return int64_t(double(matched) * double(rows) / double(estimateBlocks * estimateBlockRows) + 0.5);
+	}
+
+	void DbDataSet::runCount(const PageRequest& request)
+	{
+		const auto key = std::make_tuple(request.table.store.get(), filterValues(request.filter));
+
+		auto cancelled = [&]()
+			{
+				std::lock_guard lock(m_requestLock);
+				auto found = m_counts.find(key);
+				if (m_runningCancelled && found != m_counts.end())
+					found->second.queued = false;
+				return m_runningCancelled || found == m_counts.end();
+			};
+
+		bool estimated = false;
+		{
+			std::lock_guard lock(m_requestLock);
+			auto found = m_counts.find(key);
+			if (found == m_counts.end())
+				return;
+			estimated = found->second.estimate >= 0;
+		}
+
+		// a sample sizes the view until the exact count is in
+		if (!estimated)
+		{
+			const auto estimate = estimateRows(m_async, request.table, request.filter, request.logger);
+			if (cancelled())
+				return;
+
+			std::lock_guard lock(m_requestLock);
+			m_counts[key].estimate = estimate;
+		}
+
+		const auto exact = countRows(m_async, request.table, request.filter, request.logger, 0, int64_t(request.table.count));
+		if (cancelled())
+			return;
+
+		std::lock_guard lock(m_requestLock);
+		auto& entry = m_counts[key];
+		entry.queued = false;
+		if (exact < 0)
+		{
+			// waits a second after the first failure, twice as long after each one that follows up to a minute
+			entry.retry = std::chrono::steady_clock::now() + std::chrono::seconds(std::min(1 << std::min(entry.failures, 6), 60));
+			entry.failures++;
+			return;
+		}
+		entry.exact = exact;
+		entry.failures = 0;
+	}
+
+	void DbDataSet::LoadFromPath(const std::string& path, const std::string& pattern, const fnLogger& logger)
+	{
+		DbMetaData ret;
+		if (!std::filesystem::exists(path))
+		{
+			LOG_TO(logger, "Couldn't find file " << path << "\n");
+			throw new folder_not_found();
+		}
+
+		auto dir = canonicalPath(path);
+
+		LOG_TO(logger, "Loading from path " << dir << "\n");
+		for (const auto& file : matchingFiles(dir, pattern))
+		{
+			StopWatch hash;
+			auto print = fingerprintFile(file);
+			auto hashSeconds = hash.Seconds();
+
+			ret.tables.emplace_back(LoadTsvFile(file, print, logger));
+			ret.tables.back().ingest.hash_seconds = hashSeconds;
+		}
+
+		// statements, connections and positions belong to the tables being replaced, group bys and profiles
+		// of them are dropped once the lock is let go since that waits for their threads
+		JobCache<GroupByJob> groups;
+		JobCache<ProfileJob> profiles;
+		stopRequests();
+		m_async.Clear();
+
+		std::lock_guard lock(m_lock);
+		m_reader.Clear();
+		{
+			std::lock_guard requestLock(m_requestLock);
+			m_counts.clear();
+			groups.Swap(m_groups);
+			profiles.Swap(m_profiles);
+		}
+
+		m_meta = ret;
+		m_path = dir.string();
+		m_pattern = pattern;
+		m_identity = datasetIdentity(dir, pattern);
+	}
+
+	DbTableMetaData DbDataSet::LoadTsvFile(const std::filesystem::path& path, const Fingerprint& fingerprint, const fnLogger& logger)
+	{
+		StopWatch total;
+
+		DbTableMetaData ret{};
+
+		ret.file_name = path.string();
+
+		auto name = path.filename().string();
+		name = escapeName(name.substr(0, name.find(".")));
+
+		{
+			std::lock_guard lock(s_registryLock);
+			auto found = s_stores.find({ fingerprint.size, fingerprint.hash });
+			if (found != s_stores.end())
+				ret.store = found->second.lock();
+		}
+
+		if (ret.store && !holdsContentOf(*ret.store, path))
+		{
+			LOG_TO(logger, path << " has the fingerprint of table " << ret.store->name << " but not its content\n");
+			ret.store = nullptr;
+		}
+
+		if (ret.store)
+		{
+			ret.table_name = name;
+			ret.columns = ret.store->columns;
+			ret.count = ret.store->count;
+			ret.dictionary_saved = ret.store->dictionary_saved;
+			ret.encoding = ret.store->encoding;
+
+			LOG_TO(logger, path << " shares identical content with table " << ret.store->name << "\n");
+			return ret;
+		}
+
+		const auto modified = modifiedTime(path);
+		std::ifstream in(path.string(), std::ios::binary);
+		if (!in.is_open())
+		{
+			LOG_TO(logger, "Failed to open: " << path << "\n");
+			throw new file_not_found{path.string()};
+		}
+
+		auto store = std::make_shared<TableStore>();
+
+		LineReader reader(in);
+
+		std::string_view line;
+		std::string header;
+		if (reader.Next(line))
+			header = line;
+
+		// hold back the first rows so the column layout can be chosen from them
+		std::vector<std::string> sample;
+		while (sample.size() < dictionarySampleRows && reader.Next(line))
+		{
+			sample.emplace_back(line);
+		}
+
+		TableDesc desc = createTable(store->db, name, header, sample);
+
+		ret.table_name = desc.name;
+		ret.columns = desc.columns;
+
+		insertContext ctx = insertBegin(desc);
+
+		int nextId = 0;
+
+		auto insert = [&](std::string_view row)
+			{
+				insertTable(store->db, nextId++, desc, ctx, row);
+
+				if (ctx.count == 0 && store->SpillIfOverBudget())
+				{
+					LOG_TO(logger, path << " over the memory budget at line " << nextId << ", continuing on disk in " << store->Location().file << "\n");
+				}
+			};
+
+		for (const auto& row : sample)
+		{
+			insert(row);
+		}
+		sample.clear();
+
+		while (reader.Next(line))
+		{
+			insert(line);
+			// LOG_TO(logger, path << ": line: " << nextId << " Had len " << line.size() << "\n");
+		}
+
+		insertEnd(store->db, desc, ctx);
+
+		ret.count = ctx.wrote;
+
+		StopWatch dictionaries;
+		ret.dictionary_saved = finishDictionaries(store->db, desc, store->dictionaries);
+
+		// loaded, indexes are built next to readers from here on and WAL keeps them off each other
+		if (store->Location().tier == StorageTier::Disk)
+			sqlite3_exec(store->db, "PRAGMA journal_mode = WAL;", nullptr, nullptr, nullptr);
+
+		ret.ingest.bytes = reader.Bytes();
+		ret.ingest.read_seconds = reader.Seconds();
+		ret.ingest.insert_seconds = ctx.execSeconds + dictionaries.Seconds();
+		ret.ingest.total_seconds = total.Seconds();
+		ret.ingest.split_seconds = std::max(0.0, ret.ingest.total_seconds - ret.ingest.read_seconds - ret.ingest.insert_seconds);
+
+		store->name = desc.name;
+		store->columns = ret.columns;
+		store->count = ret.count;
+		store->dictionary_saved = ret.dictionary_saved;
+		store->types = std::move(desc.types);
+		store->encoding = ret.encoding = reader.Encoding();
+		store->fingerprint = fingerprint;
+		store->source = path;
+		store->sourceModified = modified;
+		ret.store = store;
+
+		{
+			std::lock_guard lock(s_registryLock);
+			std::erase_if(s_stores, [](const auto& entry) { return entry.second.expired(); });
+			s_stores[{ fingerprint.size, fingerprint.hash }] = store;
+		}
+
+		LOG_TO(logger, path << " loaded " << ctx.wrote << " lines, " << codec::EncodingName(ret.encoding) << "\n");
+
+		return ret;
+	}
+
 }
\ No newline at end of file
@@ -1,64 +1,820 @@
-#pragma once
-
-#include <filesystem>
-#include <functional>
-#include <vector>
-#include <string>
-#include <variant>
-
-#include "sqlite3.h"
-
-namespace data
-{
-
-	struct file_not_found { std::string path; };
-	struct folder_not_found {};
-	struct failed_db_create {};
-	struct create_failure{};
-	struct insert_failure{};
-
-	using fnLogger = std::function<void(const std::string&)>;
-
-	struct DbTableMetaData
-	{
-		std::string table_name;
-		std::string file_name;
-		std::vector<std::string> columns;
-		size_t count;
-	};
-
-	struct DbMetaData
-	{
-		std::vector<DbTableMetaData> tables;
-	};
-
-	class DbDataSet
-	{
-	private:
-		// throws
-		DbTableMetaData LoadTsvFile(const std::filesystem::path& path, const fnLogger& logger);
-
-	private:
-		sqlite3* db;
-		data::DbMetaData m_meta;
-		std::string m_path;
-		std::string m_pattern;
-
-	public:
-		// throws
-		DbDataSet();
-		virtual ~DbDataSet();
-
-		using ValType = std::variant<int, std::string>;
-
-		const std::tuple<std::string&, std::string&> GetPath() { return std::make_tuple(std::ref(m_path), std::ref(m_pattern)); }
-
-		const DbMetaData& GetTableMetaData();
-
-		void GetRows(const DbTableMetaData& table, const std::string& sort, std::function<void(const std::vector<ValType>&)> fnOnRow, const fnLogger& logger, int limit = 0, int offset = 0);
-		int GetRowCount(const DbTableMetaData& table, const fnLogger& logger);
-
-		// throws
-		void LoadFromPath(const std::string& path, const std::string& pattern, const fnLogger& logger);
-	};
-}
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+
+#include "sqlite3.h"
+#include "codec.hpp"
+#include "export.hpp"
+#include "selection.hpp"
+
+namespace data
+{
+
+	struct file_not_found { std::string path; };
+	struct folder_not_found {};
+	struct failed_db_create {};
+	struct create_failure{};
+	struct insert_failure{};
+
+	using fnLogger = std::function<void(const std::string&)>;
+
+	// Identity of a file's contents, independent of where it lives on disk
+	struct Fingerprint
+	{
+		uint64_t size = 0;
+		uint64_t hash = 0;
+
+		bool operator==(const Fingerprint&) const = default;
+	};
+
+	enum class StorageTier
+	{
+		Memory,
+		Disk,
+	};
+
+	const char* StorageTierName(StorageTier tier);
+
+	// Where a store's database lives
+	struct StoreLocation
+	{
+		StorageTier tier = StorageTier::Memory;
+		std::filesystem::path file;
+		// opens further connections to the same database
+		std::string uri;
+	};
+
+	// Once sqlite holds more than this, tables move into temp files on disk
+	void SetMemoryBudget(size_t bytes);
+	size_t GetMemoryBudget();
+
+	// Forgets the fingerprints remembered by file, the next load hashes every file again
+	void ForgetFingerprints();
+
+	struct SortKey
+	{
+		int column = 0;
+		bool descending = false;
+
+		bool operator==(const SortKey&) const = default;
+	};
+
+	// Column order of a view, row_id is always the final tie breaker
+	using SortSpec = std::vector<SortKey>;
+
+	enum class FilterOp
+	{
+		Equals,
+		// value to upper inclusive, an empty bound is open. Numeric when the bounds are numbers, text order otherwise.
+		Range,
+		Prefix,
+		// anywhere in the value, ASCII case insensitive
+		Contains,
+		Empty,
+	};
+
+	// A condition on one column's values
+	struct ColumnFilter
+	{
+		int column = 0;
+		FilterOp op = FilterOp::Equals;
+		std::string value;
+		std::string upper;
+
+		bool operator==(const ColumnFilter&) const = default;
+	};
+
+	// Rows a view is restricted to, empty keeps them all. Conditions compile to SQL that only depends
+	// on the columns and operators, values are bound, so editing a value reuses the prepared statements.
+	struct RowFilter
+	{
+		// found anywhere in a row's text, ASCII case insensitive
+		std::string search;
+		// all of them have to hold
+		std::vector<ColumnFilter> columns;
+
+		bool empty() const { return search.empty() && columns.empty(); }
+		bool operator==(const RowFilter&) const = default;
+	};
+
+	enum class AggregateOp
+	{
+		Count,
+		Sum,
+		Min,
+		Max,
+		Avg,
+	};
+
+	// Over a column's values as numbers, cells that aren't one, empty ones included, are left out. Count counts rows.
+	struct Aggregate
+	{
+		AggregateOp op = AggregateOp::Count;
+		int column = 0;
+
+		bool operator==(const Aggregate&) const = default;
+	};
+
+	// Rows matching filter grouped by the values of keys
+	struct GroupBySpec
+	{
+		std::vector<int> keys;
+		std::vector<Aggregate> aggregates;
+		RowFilter filter;
+
+		bool operator==(const GroupBySpec&) const = default;
+	};
+
+	struct GroupRow
+	{
+		std::vector<std::string> keys;
+		int64_t rows = 0;
+		// per aggregate, NaN while no value was seen
+		std::vector<double> values;
+	};
+
+	// Groups found so far, most rows first
+	struct GroupResult
+	{
+		std::vector<GroupRow> groups;
+		// rows looked at, of the table's rows
+		uint64_t scanned = 0;
+		uint64_t total = 0;
+		// stopped at maxGroups
+		bool truncated = false;
+	};
+
+	// Distribution of a column's numbers over the rows a filter selects, as far as they were read
+	struct ColumnProfile
+	{
+		// rows looked at, of the table's rows
+		uint64_t scanned = 0;
+		uint64_t total = 0;
+		// cells read as numbers, other text, and empty ones
+		uint64_t numbers = 0;
+		uint64_t texts = 0;
+		uint64_t empties = 0;
+		double min = 0;
+		double max = 0;
+		double mean = 0;
+		// at profileQuantiles, estimated
+		std::vector<double> quantiles;
+		// exact counts of equal bins from histogramLow on
+		double histogramLow = 0;
+		double binWidth = 0;
+		std::vector<uint64_t> bins;
+	};
+
+	// Row ids of a left and a right row whose keys are equal
+	struct JoinPair
+	{
+		uint32_t left = 0;
+		uint32_t right = 0;
+	};
+
+	// quantiles a ColumnProfile has, in order
+	constexpr double profileQuantiles[] = { 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99 };
+
+	// Index built in the background for a sort order or a filtered column
+	struct IndexInfo
+	{
+		std::string name;
+		SortSpec key;
+		bool ready = false;
+		bool failed = false;
+		// the table's trigram full text index rather than a btree
+		bool search = false;
+		double build_seconds = 0;
+		uint64_t bytes = 0;
+	};
+
+	// Sort permutations held for a store
+	struct PermutationStats
+	{
+		size_t count = 0;
+		uint64_t bytes = 0;
+	};
+
+	// One loaded table. Byte-identical files share a store, it is released once no data set references it
+	class TableStore : public std::enable_shared_from_this<TableStore>
+	{
+	private:
+		mutable std::mutex m_indexLock;
+		std::vector<IndexInfo> m_indexes;
+		mutable std::mutex m_locationLock;
+		StoreLocation m_location;
+
+	public:
+		// keeps the database alive, written through while loading and by the index builds after
+		sqlite3* db = nullptr;
+		std::string name;
+		std::vector<std::string> columns;
+		size_t count = 0;
+		Fingerprint fingerprint;
+		// the file the rows were read from and its write time then, a fingerprint match is confirmed against it
+		std::filesystem::path source;
+		int64_t sourceModified = 0;
+
+		// per column, values by code for dictionary encoded columns, empty for plain text
+		std::vector<std::vector<std::string>> dictionaries;
+		size_t dictionary_saved = 0;
+		// per column, the Arrow type every value of it narrowed to while loading
+		std::vector<ArrowType> types;
+		codec::Encoding encoding = codec::Encoding::Utf8;
+
+		// throws, starts on disk when already over the memory budget
+		TableStore();
+		virtual ~TableStore();
+
+		// throws, moves an in memory store into a temp file once sqlite is over the memory budget
+		bool SpillIfOverBudget();
+		StoreLocation Location() const;
+
+		// Queues a background CREATE INDEX serving key unless there is one already, or the table is small enough to sort as is
+		void RequestIndex(const SortSpec& key);
+		// name of the ready index serving key, empty while there is none
+		std::string ReadyIndex(const SortSpec& key) const;
+		// Queues a background FTS5 trigram index over the text columns, dictionary columns are searched by their values
+		void RequestSearch();
+		// name of the ready full text index, empty while there is none
+		std::string SearchIndex() const;
+		std::vector<IndexInfo> GetIndexes() const;
+		// ready sort permutations of the table, built in the background once a sort is read from
+		PermutationStats GetPermutations() const;
+		// called by the index builder
+		void IndexFinished(const std::string& name, bool ok, double seconds, uint64_t bytes);
+
+		TableStore(const TableStore&) = delete;
+		TableStore& operator=(const TableStore&) = delete;
+	};
+
+	// Where ingest time went. read includes decoding, split includes building the insert statements.
+	struct IngestStats
+	{
+		uint64_t bytes = 0;
+		double hash_seconds = 0;
+		double read_seconds = 0;
+		double split_seconds = 0;
+		double insert_seconds = 0;
+		double total_seconds = 0;
+	};
+
+	struct DbTableMetaData
+	{
+		std::string table_name;
+		std::string file_name;
+		std::vector<std::string> columns;
+		size_t count;
+		size_t dictionary_saved;
+		codec::Encoding encoding;
+		IngestStats ingest;
+		std::shared_ptr<TableStore> store;
+	};
+
+	struct DbMetaData
+	{
+		std::vector<DbTableMetaData> tables;
+	};
+
+	// Sort key values as stored: codes for dictionary columns, text otherwise
+	using KeyVal = std::variant<int64_t, std::string>;
+
+	// A position in a sort order, paging resumes right after the row it was taken from
+	struct SeekKey
+	{
+		std::vector<KeyVal> values;
+		int64_t row_id = -1;
+	};
+
+	// A cell as read: integers and reals keep their type, text is borrowed and only valid during the callback it was passed to
+	using CellView = std::variant<int64_t, double, std::string_view>;
+
+	// Table columns to read besides row_id, ascending. Empty reads all of them, { 0 } only the row id.
+	using Projection = std::vector<int>;
+
+	// Consecutive rows handed over together, cells are stored row after row.
+	// Each row is the row id followed by the projected columns.
+	struct RowBatch
+	{
+		const CellView* cells = nullptr;
+		size_t columns = 0;
+		size_t rows = 0;
+
+		std::span<const CellView> Row(size_t row) const { return { cells + row * columns, columns }; }
+	};
+
+	// Non owning reference to a batch callable, one indirect call per batch and nothing allocated
+	struct BatchSink
+	{
+		void* context = nullptr;
+		void (*call)(void*, const RowBatch&) = nullptr;
+
+		void operator()(const RowBatch& batch) const { call(context, batch); }
+
+		template <typename Fn>
+		static BatchSink Of(Fn& fn)
+		{
+			return { const_cast<void*>(static_cast<const void*>(std::addressof(fn))), [](void* context, const RowBatch& batch)
+				{
+					(*static_cast<Fn*>(context))(batch);
+				} };
+		}
+	};
+
+	// Prepared statements by connection and SQL text. Handed out reset, least recently used ones are finalized past capacity.
+	class StatementCache
+	{
+	private:
+		struct Entry
+		{
+			sqlite3* db;
+			std::string sql;
+			sqlite3_stmt* stmt;
+		};
+
+		std::list<Entry> m_lru;
+		std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+		size_t m_capacity;
+
+	public:
+		struct Stats
+		{
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t evictions = 0;
+			double prepare_seconds = 0;
+		};
+
+		explicit StatementCache(size_t capacity = 64) : m_capacity(capacity) {}
+		virtual ~StatementCache();
+
+		StatementCache(const StatementCache&) = delete;
+		StatementCache& operator=(const StatementCache&) = delete;
+
+		// null when the statement fails to prepare, sqlite3_reset it when done stepping
+		sqlite3_stmt* Acquire(sqlite3* db, const std::string& sql);
+		// finalizes everything prepared against db, null for all connections
+		void Invalidate(sqlite3* db = nullptr);
+
+		const Stats& GetStats() const { return m_stats; }
+
+	private:
+		Stats m_stats;
+	};
+
+	// Seek positions within one sort order of a table
+	struct SortPositions
+	{
+		std::vector<SeekKey> checkpoints;
+		bool built = false;
+		std::map<int, SeekKey> seen;
+	};
+
+	// What one reading thread queries with: connections, prepared statements, paging positions and batch buffers
+	class ReadContext
+	{
+	private:
+		// read only connections of our own by store
+		std::mutex m_connectionLock;
+		std::map<const TableStore*, sqlite3*> m_connections;
+		// stops waiting on a store that is busy
+		std::atomic<bool> m_interrupted{ false };
+
+		static int busyWait(void* context, int count);
+
+	public:
+		StatementCache statements;
+		std::map<std::tuple<const TableStore*, std::string>, SortPositions> positions;
+		// text cells of a batch point into batchText
+		std::vector<CellView> batchCells;
+		std::string batchText;
+		// row ids of a page read through a sort permutation
+		std::vector<uint32_t> batchIds;
+		// table columns of the page being read, row_id first
+		std::vector<int> batchColumns;
+		// dictionary cells are read as their codes, -1 for null, rather than their values
+		bool dictionaryCodes = false;
+		// set by a read that stopped before its end on an error or an interrupt, cleared by whoever checks it
+		bool readFailed = false;
+
+		ReadContext() = default;
+		virtual ~ReadContext();
+
+		ReadContext(const ReadContext&) = delete;
+		ReadContext& operator=(const ReadContext&) = delete;
+
+		// null when a connection of our own can't be opened
+		sqlite3* Connection(const TableStore& store);
+		// stops the statement running on our own connections, callable from any thread
+		void Interrupt();
+		void ResetInterrupt() { m_interrupted = false; }
+		// forgets everything tied to the current stores
+		void Clear();
+	};
+
+	class ResultQueue;
+	class ExportJob;
+	class GroupByJob;
+	class ProfileJob;
+	class JoinJob;
+
+	// Jobs by store and key, least recently asked for last. Not locked, its owner guards it.
+	template <typename Job>
+	class JobCache
+	{
+	private:
+		std::list<std::tuple<const TableStore*, std::string, std::shared_ptr<Job>>> m_jobs;
+
+	public:
+		// The job for store and key, running or done, unless it was cancelled, failed or went through other than
+		// rows rows. A job that can't be handed out again is taken out into dropped, which waits for its thread
+		// when it goes, so the caller drops it after letting go of its lock.
+		std::shared_ptr<Job> Find(const TableStore* store, const std::string& key, uint64_t rows, std::shared_ptr<Job>& dropped)
+		{
+			auto found = std::find_if(m_jobs.begin(), m_jobs.end(), [&](const auto& entry) { return std::get<0>(entry) == store && std::get<1>(entry) == key; });
+			if (found == m_jobs.end())
+				return nullptr;
+
+			auto& job = std::get<2>(*found);
+			if (!job->Cancelled() && !job->Failed() && job->Total() == rows)
+			{
+				m_jobs.splice(m_jobs.begin(), m_jobs, found);
+				return job;
+			}
+			dropped = std::move(job);
+			m_jobs.erase(found);
+			return nullptr;
+		}
+
+		// the least recently asked for goes into dropped once there are more than capacity
+		void Add(const TableStore* store, std::string key, std::shared_ptr<Job> job, size_t capacity, std::shared_ptr<Job>& dropped)
+		{
+			m_jobs.emplace_front(store, std::move(key), std::move(job));
+			if (m_jobs.size() > capacity)
+			{
+				dropped = std::move(std::get<2>(m_jobs.back()));
+				m_jobs.pop_back();
+			}
+		}
+
+		void Swap(JobCache& other) { m_jobs.swap(other.m_jobs); }
+	};
+
+	// Rows of a filtered view as known so far, an estimate until the exact count is in
+	struct RowCount
+	{
+		int64_t rows = -1;
+		bool exact = false;
+	};
+
+	class DbDataSet : public std::enable_shared_from_this<DbDataSet>
+	{
+	public:
+		using ValType = std::variant<int, std::string>;
+		using fnRow = std::function<void(const std::vector<ValType>&)>;
+		using fnWrite = data::fnWrite;
+
+	private:
+		struct PageRequest
+		{
+			std::shared_ptr<ResultQueue> queue;
+			DbTableMetaData table;
+			SortSpec sort;
+			RowFilter filter;
+			Projection projection;
+			fnLogger logger;
+			int offset = 0;
+			int limit = 0;
+			uint64_t ticket = 0;
+			// counts the filtered rows into m_counts instead of reading a page
+			bool count = false;
+			// reads the page's row ids alone into the result's ids
+			bool ids = false;
+			// reads these rows by row id instead of a page
+			bool byId = false;
+			std::vector<uint32_t> rowIds = {};
+		};
+
+		struct CountEntry
+		{
+			std::weak_ptr<TableStore> store;
+			// rows matching, -1 until counted
+			int64_t exact = -1;
+			// scaled up from a sample of the table, -1 until taken
+			int64_t estimate = -1;
+			bool queued = false;
+			uint64_t used = 0;
+			// counts that failed in a row, the next one waits until retry
+			int failures = 0;
+			std::chrono::steady_clock::time_point retry = {};
+		};
+
+		// throws
+		DbTableMetaData LoadTsvFile(const std::filesystem::path& path, const Fingerprint& fingerprint, const fnLogger& logger);
+
+		// skip rows are read past after seeking, the key before the first returned row lands in first.
+		// columns are the table columns read, row_id first.
+		int runPage(ReadContext& ctx, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const std::vector<int>& columns, const SeekKey* after, int skip, int limit, const BatchSink& sink, const fnLogger& logger, SeekKey* first, SeekKey* last);
+		int runRowIds(ReadContext& ctx, const DbTableMetaData& table, const std::vector<int>& columns, const std::vector<uint32_t>& ids, const BatchSink& sink, const fnLogger& logger);
+		void visitRows(ReadContext& ctx, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, const BatchSink& sink, const fnLogger& logger, int limit, int offset);
+		void visitRowIds(ReadContext& ctx, const DbTableMetaData& table, const Projection& projection, const std::vector<uint32_t>& ids, const BatchSink& sink, const fnLogger& logger);
+		SortPositions& sortPositions(ReadContext& ctx, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const fnLogger& logger, bool build);
+		// rows matching filter with row ids in [from, to)
+		int64_t countRows(ReadContext& ctx, const DbTableMetaData& table, const RowFilter& filter, const fnLogger& logger, int64_t from, int64_t to);
+		int64_t estimateRows(ReadContext& ctx, const DbTableMetaData& table, const RowFilter& filter, const fnLogger& logger);
+		void runCount(const PageRequest& request);
+		// under m_requestLock, made when missing
+		CountEntry& countEntry(const DbTableMetaData& table, const std::string& key);
+
+		// starts the worker when it isn't running, returns the request's ticket
+		uint64_t queueRequest(PageRequest request);
+		void runRequests();
+		void stopRequests();
+
+		void runExport(ExportJob& job, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, const RowSelection* selection, const ExportOptions& options, const fnWrite& fnOut, const fnLogger& logger);
+
+	private:
+		data::DbMetaData m_meta;
+		std::string m_path;
+		std::string m_pattern;
+		std::string m_identity;
+
+		// declared after m_meta so statements are finalized before their stores close.
+		// m_reader serves the calling thread, m_async the worker.
+		ReadContext m_reader;
+		ReadContext m_async;
+		// guards m_reader, calls may come from more than one thread
+		mutable std::mutex m_lock;
+
+		mutable std::mutex m_requestLock;
+		std::condition_variable m_requestWake;
+		std::deque<PageRequest> m_requests;
+		const ResultQueue* m_running = nullptr;
+		// the count being run, by store and filter key
+		const TableStore* m_countingStore = nullptr;
+		std::string m_countingKey;
+		bool m_runningCancelled = false;
+		bool m_stopping = false;
+		uint64_t m_tickets = 0;
+		StatementCache::Stats m_asyncStats;
+		// by store and filter, guarded by m_requestLock
+		std::map<std::tuple<const TableStore*, std::string>, CountEntry> m_counts;
+		uint64_t m_countUses = 0;
+		// by store and spec, guarded by m_requestLock
+		JobCache<GroupByJob> m_groups;
+		JobCache<ProfileJob> m_profiles;
+		std::thread m_worker;
+
+	public:
+		DbDataSet() = default;
+		virtual ~DbDataSet();
+
+		// throws, returns the already loaded data set when path resolves to the same location and content
+		static std::shared_ptr<DbDataSet> Open(const std::string& path, const std::string& pattern, const fnLogger& logger);
+
+		const std::tuple<std::string&, std::string&> GetPath() { return std::make_tuple(std::ref(m_path), std::ref(m_pattern)); }
+
+		const DbMetaData& GetTableMetaData();
+
+		// Rows as batches of CellView, fnOnBatch is any callable taking const RowBatch&. Dictionary columns
+		// come decoded, cells are only valid until fnOnBatch returns. Columns outside projection aren't read.
+		template <typename Fn>
+		void VisitRows(const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, Fn&& fnOnBatch, const fnLogger& logger, int limit = 0, int offset = 0)
+		{
+			std::lock_guard lock(m_lock);
+			visitRows(m_reader, table, sort, filter, projection, BatchSink::Of(fnOnBatch), logger, limit, offset);
+		}
+
+		// Rows by row id in the order of ids as batches like VisitRows, ids past the table's rows are left out
+		template <typename Fn>
+		void VisitRowIds(const DbTableMetaData& table, const Projection& projection, const std::vector<uint32_t>& ids, Fn&& fnOnBatch, const fnLogger& logger)
+		{
+			std::lock_guard lock(m_lock);
+			visitRowIds(m_reader, table, projection, ids, BatchSink::Of(fnOnBatch), logger);
+		}
+
+		// Pages by seeking from the nearest known position instead of skipping offset rows
+		void GetRows(const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, fnRow fnOnRow, const fnLogger& logger, int limit = 0, int offset = 0);
+		void GetRowIds(const DbTableMetaData& table, const Projection& projection, const std::vector<uint32_t>& ids, fnRow fnOnRow, const fnLogger& logger);
+		// Rows following after (from the start when null), last receives the key of the final row
+		void GetRowsAfter(const DbTableMetaData& table, const SortSpec& sort, const SeekKey* after, fnRow fnOnRow, const fnLogger& logger, int limit = 0, SeekKey* last = nullptr);
+		// exact, counts on the calling thread unless known already
+		int64_t GetRowCount(const DbTableMetaData& table, const RowFilter& filter, const fnLogger& logger);
+		// Never blocks. Exact once counted on the worker, an estimate from a sample meanwhile, -1 before either. Only the
+		// latest filter asked for per table is counted, the one running for another filter is interrupted. A count that
+		// failed is tried again after a while, longer each time it fails.
+		RowCount GetCount(const DbTableMetaData& table, const RowFilter& filter, const fnLogger& logger);
+
+		// Adds the rows at positions [from, to) of the sorted, filtered table to selection. Unsorted tables add the
+		// range as is and a sort with a permutation copies its slice, both right away. Anything else reads just the
+		// row ids in one pass on the worker, the result pushed to queue holds them in ids. Returns the request's
+		// ticket, 0 when the range was added already.
+		uint64_t SelectRange(const std::shared_ptr<ResultQueue>& queue, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, int from, int to, RowSelection& selection, const fnLogger& logger);
+
+		// Streams the selected rows of the sorted, filtered table, all of them without a selection, as TSV or CSV: a header of the
+		// column names and then the row id and projected columns of each row. Rows are read on a thread of their own and
+		// formatted into buffers of a few megabytes, which a second thread hands to fnOut as they fill up.
+		std::shared_ptr<ExportJob> Export(const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, const RowSelection* selection, const ExportOptions& options, fnWrite fnOut, const fnLogger& logger);
+
+		// Groups the table's rows on a thread of its own, partial results are there while it runs. The job for the same
+		// table and spec is handed out again, running or done, unless it was cancelled.
+		std::shared_ptr<GroupByJob> GroupBy(const DbTableMetaData& table, const GroupBySpec& spec, const fnLogger& logger);
+
+		// Profiles a column's values in one pass on a thread of its own, kept and handed out again like GroupBy's jobs
+		std::shared_ptr<ProfileJob> Profile(const DbTableMetaData& table, int column, const RowFilter& filter, const fnLogger& logger);
+
+		// Inner join of two tables on equal text in a key column each, on a thread of its own. The smaller table is hashed
+		// and the larger one streamed past it, pairs come in the larger table's row order as they are found. Empty keys
+		// match nothing.
+		std::shared_ptr<JoinJob> Join(const DbTableMetaData& left, int leftColumn, const DbTableMetaData& right, int rightColumn, const fnLogger& logger);
+
+		// Reads a page on the data set's worker thread, the result is pushed to queue. Returns the request's ticket.
+		uint64_t Submit(const std::shared_ptr<ResultQueue>& queue, const DbTableMetaData& table, const SortSpec& sort, const RowFilter& filter, const Projection& projection, int offset, int limit, const fnLogger& logger);
+		// Reads rows by row id like GetRowIds on the worker thread, the result is pushed to queue. Returns the request's ticket.
+		uint64_t SubmitRowIds(const std::shared_ptr<ResultQueue>& queue, const DbTableMetaData& table, const Projection& projection, std::vector<uint32_t> ids, const fnLogger& logger);
+		// Drops the requests queued for queue, and unless told otherwise interrupts the one running for it
+		void Cancel(const ResultQueue* queue, bool running = true);
+
+		// both contexts, the worker's as of its last finished request
+		StatementCache::Stats GetStatementStats() const;
+
+		// throws
+		void LoadFromPath(const std::string& path, const std::string& pattern, const fnLogger& logger);
+	};
+
+	// What the jobs running on a thread of their own share: a read context, the flags and the thread. A job's
+	// destructor calls stop, which cancels it and waits for the thread, before the job's own members go.
+	class BackgroundJob
+	{
+	protected:
+		ReadContext m_ctx;
+		std::atomic<bool> m_cancelled{ false };
+		std::atomic<bool> m_done{ false };
+		std::atomic<bool> m_failed{ false };
+		// rows the job goes through, set before it starts
+		uint64_t m_total = 0;
+		std::thread m_thread;
+
+		// runs fn on the job's thread, the job is done once it returns
+		template <typename Fn>
+		void start(Fn&& fn)
+		{
+			m_thread = std::thread([this, fn = std::forward<Fn>(fn)]() mutable
+				{
+					fn();
+					m_done.store(true, std::memory_order_release);
+				});
+		}
+		void stop();
+
+	public:
+		BackgroundJob() = default;
+		virtual ~BackgroundJob();
+
+		BackgroundJob(const BackgroundJob&) = delete;
+		BackgroundJob& operator=(const BackgroundJob&) = delete;
+
+		void Cancel();
+
+		bool Done() const { return m_done.load(std::memory_order_acquire); }
+		bool Cancelled() const { return m_cancelled; }
+		bool Failed() const { return m_failed; }
+		uint64_t Total() const { return m_total; }
+	};
+
+	// An export running, dropping it cancels the export and waits for it to stop. Once done the output has been
+	// let go of, so files are closed. Total is the rows selected or the view's count.
+	class ExportJob : public BackgroundJob
+	{
+	private:
+		friend class DbDataSet;
+
+		std::atomic<uint64_t> m_rows{ 0 };
+
+	public:
+		ExportJob() = default;
+		virtual ~ExportJob();
+
+		// rows written so far
+		uint64_t Rows() const { return m_rows; }
+	};
+
+	// A group by running or done, dropping it cancels it and waits for it to stop. Total is the table's rows when it started.
+	class GroupByJob : public BackgroundJob
+	{
+	private:
+		friend class DbDataSet;
+
+		mutable std::mutex m_lock;
+		std::shared_ptr<const GroupResult> m_result;
+
+		void run(const DbTableMetaData& table, const GroupBySpec& spec, const fnLogger& logger);
+
+	public:
+		GroupByJob() = default;
+		virtual ~GroupByJob();
+
+		// as of the last block of rows, null before the first
+		std::shared_ptr<const GroupResult> Result() const;
+	};
+
+	// A column profile running or done, dropping it cancels it and waits for it to stop. Total is the table's rows when it started.
+	class ProfileJob : public BackgroundJob
+	{
+	private:
+		friend class DbDataSet;
+
+		mutable std::mutex m_lock;
+		std::shared_ptr<const ColumnProfile> m_result;
+
+		void run(const DbTableMetaData& table, int column, const RowFilter& filter, const fnLogger& logger);
+
+	public:
+		ProfileJob() = default;
+		virtual ~ProfileJob();
+
+		// as of the last rows published, null before the first
+		std::shared_ptr<const ColumnProfile> Result() const;
+	};
+
+	// A join running or done, its pairs can be read while more are added. Dropping it cancels it and waits for it to stop.
+	// Total is the rows of both tables.
+	class JoinJob : public BackgroundJob
+	{
+	private:
+		friend class DbDataSet;
+
+		static constexpr size_t chunkPairs = 65536;
+
+		std::atomic<bool> m_truncated{ false };
+		// rows of both tables read
+		std::atomic<uint64_t> m_scanned{ 0 };
+		std::atomic<uint64_t> m_rows{ 0 };
+		mutable std::mutex m_lock;
+		std::vector<std::unique_ptr<JoinPair[]>> m_chunks;
+
+		void run(const DbTableMetaData& left, int leftColumn, const DbTableMetaData& right, int rightColumn, const fnLogger& logger);
+		void append(const std::vector<JoinPair>& pairs);
+
+	public:
+		JoinJob() = default;
+		virtual ~JoinJob();
+
+		// stopped at the most pairs a join keeps
+		bool Truncated() const { return m_truncated; }
+		uint64_t Scanned() const { return m_scanned; }
+
+		// pairs found so far
+		uint64_t Rows() const { return m_rows.load(std::memory_order_acquire); }
+		// Pairs [from, to) of those found so far
+		void Pairs(uint64_t from, uint64_t to, std::vector<JoinPair>& pairs) const;
+	};
+
+	// A page read by the worker, rows as GetRows delivers them
+	struct PageResult
+	{
+		uint64_t ticket = 0;
+		int offset = 0;
+		std::vector<std::vector<DbDataSet::ValType>> rows;
+		// row ids alone, for the requests asking for just those
+		std::vector<uint32_t> ids;
+		// the read stopped on an error or an interrupt, fewer rows than asked for says nothing about the end
+		bool failed = false;
+		PageResult* next = nullptr;
+	};
+
+	// Finished pages for one consumer. The worker pushes and the consumer takes everything at once, neither locks.
+	class ResultQueue
+	{
+	private:
+		std::atomic<PageResult*> m_head{ nullptr };
+
+	public:
+		ResultQueue() = default;
+		virtual ~ResultQueue();
+
+		ResultQueue(const ResultQueue&) = delete;
+		ResultQueue& operator=(const ResultQueue&) = delete;
+
+		void Push(std::unique_ptr<PageResult> result);
+		// oldest first
+		std::vector<std::unique_ptr<PageResult>> TakeAll();
+	};
+}